@@ -60,6 +60,14 @@ public:
     void no_data_value(value_type value);
     GDALDataType data_type() const;
 
+    /**
+     * \brief The values of the raster are (elevation - offset) / scale,
+     * stored as the GDAL scale and offset of the band.
+     */
+    double scale() const;
+    double offset() const;
+    void scale_offset(double scale, double offset);
+
     geo::PixelCenterCoordinate to_geocoordinate(
         const coordinates::RasterCoordinate &) const;
 
@@ -72,6 +80,8 @@ private:
     geo::RasterArea area_;
     std::vector<T> data_;
     std::map<std::string, value_type> special_values_;
+    double scale_;
+    double offset_;
 };
 
 
@@ -85,7 +95,9 @@ Raster<T>::Raster(
         const geo::RasterArea & area__,
         const std::string &name__):
     name_ {name__},
-    area_ {area__}
+    area_ {area__},
+    scale_ {1},
+    offset_ {0}
 {
 }
 
@@ -177,6 +189,25 @@ GDALDataType Raster<T>::data_type() const
     return io::GDAL::toGDALDataType<T>();
 }
 
+template<typename T>
+double Raster<T>::scale() const
+{
+    return scale_;
+}
+
+template<typename T>
+double Raster<T>::offset() const
+{
+    return offset_;
+}
+
+template<typename T>
+void Raster<T>::scale_offset(double scale, double offset)
+{
+    scale_ = scale;
+    offset_ = offset;
+}
+
 template<typename T>
 std::string Raster<T>::name() const
 {
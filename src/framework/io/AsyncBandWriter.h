@@ -0,0 +1,184 @@
+#ifndef ASYNC_BAND_WRITER_H_
+#define ASYNC_BAND_WRITER_H_
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+namespace io {
+
+    namespace GDAL {
+
+        /**
+         * \brief Pass the bands of rows of nx pixels to another band
+         * writer in a separate thread.
+         *
+         * The bands are copied to one of n_buffers buffers and queued, so
+         * the interpolation can continue with the next band while the
+         * previous ones are compressed and written. When all the buffers
+         * are in the queue, the caller waits for the writer. The writer is
+         * idle most of the time, so it sleeps on a condition variable
+         * instead of spinning. An exception thrown by the writer is thrown
+         * again from the next call or from finish().
+         */
+        template<typename T, typename W>
+        class AsyncBandWriter
+        {
+            public:
+                AsyncBandWriter(W & writer, unsigned int nx, size_t n_buffers):
+                    writer_ (writer),
+                    nx_ {nx},
+                    buffers_(std::max(n_buffers, static_cast<size_t>(1))),
+                    done_ {false},
+                    finished_ {false},
+                    n_bands_ {0},
+                    write_seconds_ {0},
+                    wait_seconds_ {0}
+                {
+                    for (auto &b: buffers_) free_.push_back(&b);
+                    thread_ = std::thread {[this]() { run(); }};
+                }
+
+                AsyncBandWriter(const AsyncBandWriter &) = delete;
+                AsyncBandWriter & operator=(const AsyncBandWriter &) = delete;
+
+                ~AsyncBandWriter()
+                {
+                    if (finished_) return;
+                    {
+                        std::lock_guard<std::mutex> lock {m_};
+                        done_ = true;
+                        queue_.clear();
+                    }
+                    cv_.notify_all();
+                    thread_.join();
+                }
+
+                /**
+                 * \brief Queue the n_rows rows starting from row_start to
+                 * be written.
+                 */
+                void operator()(
+                    const T * rows,
+                    unsigned int row_start,
+                    unsigned int n_rows)
+                {
+                    Band *band;
+                    {
+                        Clock::time_point t0 {Clock::now()};
+                        std::unique_lock<std::mutex> lock {m_};
+                        cv_.wait(lock, [this]() { return error_ || !free_.empty(); });
+                        wait_seconds_ += seconds_since(t0);
+                        if (error_) std::rethrow_exception(error_);
+                        band = free_.back();
+                        free_.pop_back();
+                    }
+                    band->rows.assign(rows, rows + static_cast<size_t>(n_rows) * nx_);
+                    band->row_start = row_start;
+                    band->n_rows = n_rows;
+                    {
+                        std::lock_guard<std::mutex> lock {m_};
+                        queue_.push_back(band);
+                    }
+                    cv_.notify_all();
+                }
+
+                /**
+                 * \brief Wait until all the queued bands have been written.
+                 */
+                void finish()
+                {
+                    if (finished_) return;
+                    finished_ = true;
+                    {
+                        std::lock_guard<std::mutex> lock {m_};
+                        done_ = true;
+                    }
+                    cv_.notify_all();
+                    thread_.join();
+                    if (error_) std::rethrow_exception(error_);
+                    std::stringstream ss;
+                    ss << std::fixed << std::setprecision(2)
+                        << "Wrote " << n_bands_ << " bands in "
+                        << write_seconds_ << " s in the background, waited "
+                        << wait_seconds_ << " s for the writer.";
+                    std::cout << ss.str() << std::endl;
+                }
+
+            private:
+                using Clock = std::chrono::steady_clock;
+
+                struct Band
+                {
+                    std::vector<T> rows;
+                    unsigned int row_start;
+                    unsigned int n_rows;
+                };
+
+                W &writer_;
+                unsigned int nx_;
+                std::vector<Band> buffers_;
+                std::vector<Band*> free_;
+                std::deque<Band*> queue_;
+                std::mutex m_;
+                std::condition_variable cv_;
+                std::thread thread_;
+                std::exception_ptr error_;
+                bool done_;
+                bool finished_;
+                size_t n_bands_;
+                double write_seconds_;
+                double wait_seconds_;
+
+                static double seconds_since(const Clock::time_point &t0)
+                {
+                    return std::chrono::duration<double>(Clock::now() - t0).count();
+                }
+
+                void run()
+                {
+                    for (;;) {
+                        Band *band;
+                        {
+                            std::unique_lock<std::mutex> lock {m_};
+                            cv_.wait(lock, [this]() { return done_ || !queue_.empty(); });
+                            if (queue_.empty()) return;
+                            band = queue_.front();
+                            queue_.pop_front();
+                        }
+                        try {
+                            Clock::time_point t0 {Clock::now()};
+                            writer_(static_cast<const T *>(band->rows.data()),
+                                band->row_start, band->n_rows);
+                            write_seconds_ += seconds_since(t0);
+                            ++n_bands_;
+                        } catch (...) {
+                            std::lock_guard<std::mutex> lock {m_};
+                            error_ = std::current_exception();
+                            queue_.clear();
+                            cv_.notify_all();
+                            return;
+                        }
+                        {
+                            std::lock_guard<std::mutex> lock {m_};
+                            free_.push_back(band);
+                        }
+                        cv_.notify_all();
+                    }
+                }
+        };
+
+    }
+
+}
+
+#endif
@@ -0,0 +1,847 @@
+#include "CogWriter.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+#include <type_traits>
+
+#include <ogr_spatialref.h>
+#include <zlib.h>
+
+namespace {
+
+    // The TIFF field types.
+    const std::uint16_t ascii_type {2};
+    const std::uint16_t short_type {3};
+    const std::uint16_t long_type {4};
+    const std::uint16_t double_type {12};
+    const std::uint16_t long8_type {16};
+
+    /// The TIFF tags in the order of their numbers.
+    enum Tag: std::uint16_t {
+        NEW_SUBFILE_TYPE = 254,
+        IMAGE_WIDTH = 256,
+        IMAGE_LENGTH = 257,
+        BITS_PER_SAMPLE = 258,
+        COMPRESSION = 259,
+        PHOTOMETRIC = 262,
+        SAMPLES_PER_PIXEL = 277,
+        PLANAR_CONFIGURATION = 284,
+        PREDICTOR = 317,
+        TILE_WIDTH = 322,
+        TILE_LENGTH = 323,
+        TILE_OFFSETS = 324,
+        TILE_BYTE_COUNTS = 325,
+        SAMPLE_FORMAT = 339,
+        MODEL_PIXEL_SCALE = 33550,
+        MODEL_TIEPOINT = 33922,
+        GEO_KEY_DIRECTORY = 34735,
+        GDAL_METADATA = 42112,
+        GDAL_NODATA = 42113
+    };
+
+    bool is_little_endian()
+    {
+        const std::uint16_t one {1};
+        return *reinterpret_cast<const unsigned char*>(&one) == 1;
+    }
+
+    /**
+     * \brief A field of an image file directory with its values in the
+     * byte order of the machine.
+     */
+    struct Entry
+    {
+        std::uint16_t tag;
+        std::uint16_t type;
+        std::uint64_t count;
+        std::vector<char> data;
+    };
+
+    template<typename T>
+    Entry make_entry(std::uint16_t tag, std::uint16_t type, const std::vector<T> &values)
+    {
+        Entry e {tag, type, values.size(), std::vector<char>(values.size() * sizeof(T))};
+        if (!values.empty()) std::memcpy(e.data.data(), values.data(), e.data.size());
+        return e;
+    }
+
+    Entry make_ascii_entry(std::uint16_t tag, const std::string &s)
+    {
+        Entry e {tag, ascii_type, s.size() + 1, std::vector<char>(s.begin(), s.end())};
+        e.data.push_back('\0');
+        return e;
+    }
+
+    template<typename T>
+    void append(std::vector<char> &out, T value)
+    {
+        const char *p {reinterpret_cast<const char*>(&value)};
+        out.insert(out.end(), p, p + sizeof(T));
+    }
+
+    /**
+     * \brief Serialize the directory to be written at the position pos
+     * in the file, followed by the values that do not fit in the fields.
+     * next is the position of the next directory, or 0 for none. Return
+     * the positions of the values of the fields in the file.
+     */
+    std::vector<std::uint64_t> serialize_ifd(
+        const std::vector<Entry> &entries,
+        std::uint64_t pos,
+        std::uint64_t next,
+        bool bigtiff,
+        std::vector<char> &out)
+    {
+        const size_t count_size {bigtiff ? 8u : 2u};
+        const size_t entry_size {bigtiff ? 20u : 12u};
+        const size_t offset_size {bigtiff ? 8u : 4u};
+        std::uint64_t data_pos {pos + count_size + entries.size() * entry_size +
+            offset_size};
+        std::vector<std::uint64_t> value_pos;
+        std::vector<char> data;
+        out.clear();
+        if (bigtiff) {
+            append(out, static_cast<std::uint64_t>(entries.size()));
+        } else {
+            append(out, static_cast<std::uint16_t>(entries.size()));
+        }
+        for (const auto &e: entries) {
+            append(out, e.tag);
+            append(out, e.type);
+            if (bigtiff) {
+                append(out, e.count);
+            } else {
+                append(out, static_cast<std::uint32_t>(e.count));
+            }
+            std::vector<char> value(offset_size, 0);
+            if (e.data.size() <= offset_size) {
+                std::copy(e.data.begin(), e.data.end(), value.begin());
+                value_pos.push_back(pos + out.size());
+            } else {
+                // The values out of the directory start at word
+                // boundaries.
+                if (data.size() % 2) data.push_back(0);
+                std::uint64_t p {data_pos + data.size()};
+                std::memcpy(value.data(), &p, offset_size);
+                value_pos.push_back(p);
+                data.insert(data.end(), e.data.begin(), e.data.end());
+            }
+            out.insert(out.end(), value.begin(), value.end());
+        }
+        std::vector<char> next_bytes(offset_size, 0);
+        std::memcpy(next_bytes.data(), &next, offset_size);
+        out.insert(out.end(), next_bytes.begin(), next_bytes.end());
+        out.insert(out.end(), data.begin(), data.end());
+        // The next directory starts at a word boundary.
+        if (out.size() % 2) out.push_back(0);
+        return value_pos;
+    }
+
+    /**
+     * \brief The GeoKeyDirectory of the reference system, with the EPSG
+     * code of the projected or geographic coordinate system when there
+     * is one.
+     */
+    std::vector<std::uint16_t> geo_keys(const geo::ReferenceSystem &crs)
+    {
+        // Version 1.1.0 and the number of the keys.
+        std::vector<std::uint16_t> keys {1, 1, 0, 0};
+        auto add_key = [&keys](std::uint16_t id, std::uint16_t value) {
+            keys.insert(keys.end(), {id, 0, 1, value});
+            ++keys[3];
+        };
+        std::string wkt {crs.string()};
+        OGRSpatialReference ref {wkt.c_str()};
+        bool known {wkt != "not_defined" && ref.Validate() == OGRERR_NONE};
+        const char *code {nullptr};
+        if (known) {
+            ref.AutoIdentifyEPSG();
+            // The keys hold the code of the horizontal part of a compound
+            // reference system, not the code of the compound one.
+            const char *node {nullptr};
+            if (ref.IsCompound()) node = ref.IsProjected() ? "PROJCS" : "GEOGCS";
+            const char *authority {ref.GetAuthorityName(node)};
+            if (authority && std::string(authority) == "EPSG") {
+                code = ref.GetAuthorityCode(node);
+            }
+        }
+        bool geographic {known && ref.IsGeographic()};
+        // GTModelTypeGeoKey: projected or geographic.
+        if (known) add_key(1024, geographic ? 2 : 1);
+        // GTRasterTypeGeoKey: the values are areas of the pixels.
+        add_key(1025, 1);
+        if (known && !code) {
+            // Only the EPSG codes are written, and a GeoTIFF without the
+            // reference system would be silently misplaced.
+            throw std::runtime_error("The reference system has no EPSG code, so "
+                "it cannot be stored in the GeoTIFF written with --cog. Give the "
+                "reference system as an EPSG code or write the file without --cog.");
+        }
+        if (code) {
+            char *end {nullptr};
+            long value {std::strtol(code, &end, 10)};
+            if (*end != '\0' || value <= 0 ||
+                value > std::numeric_limits<std::uint16_t>::max()) {
+                std::stringstream ss;
+                ss << "The EPSG code '" << code << "' of the reference system "
+                    "does not fit in the GeoTIFF keys written with --cog.";
+                throw std::runtime_error(ss.str());
+            }
+            // ProjectedCSTypeGeoKey or GeographicTypeGeoKey.
+            add_key(geographic ? 2048 : 3072, static_cast<std::uint16_t>(value));
+        }
+        return keys;
+    }
+
+    /**
+     * \brief The value in the sample type in the byte order of the
+     * machine.
+     */
+    std::vector<char> sample_bytes(double value, GDALDataType type)
+    {
+        std::vector<char> bytes;
+        switch (type) {
+            case GDT_Byte: append(bytes, static_cast<std::uint8_t>(value)); break;
+            case GDT_UInt16: append(bytes, static_cast<std::uint16_t>(value)); break;
+            case GDT_Int16: append(bytes, static_cast<std::int16_t>(value)); break;
+            case GDT_UInt32: append(bytes, static_cast<std::uint32_t>(value)); break;
+            case GDT_Int32: append(bytes, static_cast<std::int32_t>(value)); break;
+            case GDT_Float32: append(bytes, static_cast<float>(value)); break;
+            case GDT_Float64: append(bytes, value); break;
+            default:
+                throw std::runtime_error(
+                    "The data type is not supported by the GeoTIFF writer.");
+        }
+        return bytes;
+    }
+
+    bool is_floating_point(GDALDataType type)
+    {
+        return type == GDT_Float32 || type == GDT_Float64;
+    }
+
+    /// The TIFF SampleFormat of the data type.
+    std::uint16_t sample_format(GDALDataType type)
+    {
+        if (is_floating_point(type)) return 3;
+        if (type == GDT_Int16 || type == GDT_Int32) return 2;
+        return 1;
+    }
+
+    /**
+     * \brief Apply the floating point predictor to a row of n samples of
+     * b bytes: the bytes are arranged from the most significant byte of
+     * all the samples to the least significant one, and each byte is
+     * replaced with its difference from the previous one.
+     */
+    void floating_point_predictor(char *row, size_t n, size_t b, std::vector<char> &tmp)
+    {
+        tmp.assign(row, row + n * b);
+        const bool little {is_little_endian()};
+        for (size_t i = 0; i < n; ++i) {
+            for (size_t s = 0; s < b; ++s) {
+                size_t byte {little ? b - 1 - s : s};
+                row[s * n + i] = tmp[i * b + byte];
+            }
+        }
+        unsigned char *u {reinterpret_cast<unsigned char*>(row)};
+        for (size_t k = n * b - 1; k > 0; --k) {
+            u[k] = static_cast<unsigned char>(u[k] - u[k - 1]);
+        }
+    }
+
+    /**
+     * \brief Apply the horizontal differencing predictor to a row of n
+     * integer samples.
+     */
+    template<typename U>
+    void horizontal_predictor(char *row, size_t n)
+    {
+        for (size_t i = n - 1; i > 0; --i) {
+            U a, b;
+            std::memcpy(&a, row + i * sizeof(U), sizeof(U));
+            std::memcpy(&b, row + (i - 1) * sizeof(U), sizeof(U));
+            a = static_cast<U>(a - b);
+            std::memcpy(row + i * sizeof(U), &a, sizeof(U));
+        }
+    }
+
+
+    /**
+     * \brief Reduce the rows a and b of nx samples of the type T to a
+     * row of (nx + 1) / 2 samples, each from the 2 x 2 samples above it.
+     * The average ignores the no-data values; the last column of an odd
+     * width is averaged with itself.
+     */
+    template<typename T>
+    void reduce(
+        const char *a,
+        const char *b,
+        unsigned int nx,
+        bool average,
+        bool has_no_data_value,
+        double no_data_value,
+        char *out)
+    {
+        const T no_data {static_cast<T>(no_data_value)};
+        const unsigned int nx_out {(nx + 1) / 2};
+        for (unsigned int i = 0; i < nx_out; ++i) {
+            const unsigned int i0 {2 * i};
+            const unsigned int i1 {std::min(2 * i + 1, nx - 1)};
+            T v[4];
+            std::memcpy(&v[0], a + i0 * sizeof(T), sizeof(T));
+            std::memcpy(&v[1], a + i1 * sizeof(T), sizeof(T));
+            std::memcpy(&v[2], b + i0 * sizeof(T), sizeof(T));
+            std::memcpy(&v[3], b + i1 * sizeof(T), sizeof(T));
+            T r {v[0]};
+            if (average) {
+                double sum {0};
+                int n {0};
+                for (const T &x: v) {
+                    if (has_no_data_value && x == no_data) continue;
+                    sum += x;
+                    ++n;
+                }
+                if (n == 0) {
+                    r = no_data;
+                } else if (std::is_integral<T>::value) {
+                    r = static_cast<T>(std::round(sum / n));
+                } else {
+                    r = static_cast<T>(sum / n);
+                }
+            }
+            std::memcpy(out + i * sizeof(T), &r, sizeof(T));
+        }
+    }
+
+}
+
+namespace io {
+
+    namespace tiff {
+
+        OverviewResampling overview_resampling_from_string(const std::string &s)
+        {
+            if (s == "average") return OverviewResampling::AVERAGE;
+            if (s == "nearest") return OverviewResampling::NEAREST;
+            std::stringstream ss;
+            ss << "Unknown overview resampling method '" << s << "'.";
+            throw std::runtime_error(ss.str());
+        }
+
+        CogWriter::CogWriter(
+            const boost::filesystem::path & file,
+            const geo::RasterArea & area,
+            GDALDataType data_type,
+            bool has_no_data_value,
+            double no_data_value,
+            double scale,
+            double offset,
+            unsigned int n_threads,
+            unsigned int n_overviews,
+            OverviewResampling resampling,
+            unsigned int tile_size):
+                filename_ {file.string()},
+                tile_size_ {tile_size},
+                sample_size_ {static_cast<unsigned int>(
+                    GDALGetDataTypeSize(data_type) / 8)},
+                data_type_ {data_type},
+                has_no_data_value_ {has_no_data_value},
+                no_data_value_ {has_no_data_value ? no_data_value : 0},
+                fill_ {sample_bytes(no_data_value_, data_type)},
+                n_threads_ {std::max(n_threads, 1u)},
+                resampling_ {resampling},
+                end_ {0},
+                job_ {nullptr},
+                next_tile_ {0},
+                n_done_ {0},
+                stop_ {false}
+        {
+            // The full resolution image and the overviews down to the
+            // first one that fits in a tile.
+            unsigned int nx {area.pixel_width()};
+            unsigned int ny {area.pixel_height()};
+            for (unsigned int k = 0; k <= n_overviews; ++k) {
+                if (k > 0) {
+                    if (nx <= tile_size_ && ny <= tile_size_) {
+                        std::cout << "Made " << (k - 1) << " of the " << n_overviews
+                            << " overviews, the last one fits in a tile." << std::endl;
+                        break;
+                    }
+                    nx = (nx + 1) / 2;
+                    ny = (ny + 1) / 2;
+                }
+                Level level {};
+                level.nx = nx;
+                level.ny = ny;
+                level.n_tx = (nx + tile_size_ - 1) / tile_size_;
+                level.n_ty = (ny + tile_size_ - 1) / tile_size_;
+                levels_.push_back(std::move(level));
+            }
+
+            const size_t tile_bytes {static_cast<size_t>(tile_size_) * tile_size_ *
+                sample_size_};
+            // The directories are small, so this bounds the size of the
+            // file.
+            double max_size {1 << 20};
+            for (const auto &level: levels_) {
+                max_size += static_cast<double>(level.n_tx) * level.n_ty *
+                    compressBound(static_cast<uLong>(tile_bytes));
+            }
+            bigtiff_ = max_size > std::numeric_limits<std::uint32_t>::max();
+
+            std::vector<std::vector<Entry>> directories;
+            for (size_t l = 0; l < levels_.size(); ++l) {
+                const Level &level {levels_[l]};
+                const size_t n_tiles {static_cast<size_t>(level.n_tx) * level.n_ty};
+                std::vector<Entry> entries;
+                if (l > 0) {
+                    // A reduced resolution version of the image.
+                    entries.push_back(make_entry<std::uint32_t>(
+                        NEW_SUBFILE_TYPE, long_type, {1}));
+                }
+                entries.push_back(make_entry<std::uint32_t>(IMAGE_WIDTH, long_type, {level.nx}));
+                entries.push_back(make_entry<std::uint32_t>(IMAGE_LENGTH, long_type, {level.ny}));
+                entries.push_back(make_entry<std::uint16_t>(BITS_PER_SAMPLE, short_type,
+                    {static_cast<std::uint16_t>(8 * sample_size_)}));
+                // Deflate
+                entries.push_back(make_entry<std::uint16_t>(COMPRESSION, short_type, {8}));
+                // BlackIsZero
+                entries.push_back(make_entry<std::uint16_t>(PHOTOMETRIC, short_type, {1}));
+                entries.push_back(make_entry<std::uint16_t>(SAMPLES_PER_PIXEL, short_type, {1}));
+                entries.push_back(make_entry<std::uint16_t>(PLANAR_CONFIGURATION, short_type, {1}));
+                entries.push_back(make_entry<std::uint16_t>(PREDICTOR, short_type,
+                    {static_cast<std::uint16_t>(is_floating_point(data_type_) ? 3 : 2)}));
+                entries.push_back(make_entry<std::uint32_t>(TILE_WIDTH, long_type, {tile_size_}));
+                entries.push_back(make_entry<std::uint32_t>(TILE_LENGTH, long_type, {tile_size_}));
+                if (bigtiff_) {
+                    std::vector<std::uint64_t> zeros(n_tiles, 0);
+                    entries.push_back(make_entry(TILE_OFFSETS, long8_type, zeros));
+                    entries.push_back(make_entry(TILE_BYTE_COUNTS, long8_type, zeros));
+                } else {
+                    std::vector<std::uint32_t> zeros(n_tiles, 0);
+                    entries.push_back(make_entry(TILE_OFFSETS, long_type, zeros));
+                    entries.push_back(make_entry(TILE_BYTE_COUNTS, long_type, zeros));
+                }
+                entries.push_back(make_entry<std::uint16_t>(SAMPLE_FORMAT, short_type,
+                    {sample_format(data_type_)}));
+                if (l == 0) {
+                    // The overviews are georeferenced by the full
+                    // resolution image.
+                    entries.push_back(make_entry<double>(MODEL_PIXEL_SCALE, double_type,
+                        {area.cell_size(), area.cell_size(), 0}));
+                    entries.push_back(make_entry<double>(MODEL_TIEPOINT, double_type,
+                        {0, 0, 0, area.left(), area.top(), 0}));
+                    entries.push_back(make_entry(GEO_KEY_DIRECTORY, short_type,
+                        geo_keys(area.CRS())));
+                }
+                if (l == 0 && (scale != 1 || offset != 0)) {
+                    // The metadata of the band as GDAL stores it.
+                    std::stringstream ss;
+                    ss << std::setprecision(std::numeric_limits<double>::digits10)
+                        << "<GDALMetadata>\n"
+                        << "  <Item name=\"OFFSET\" sample=\"0\" role=\"offset\">"
+                        << offset << "</Item>\n"
+                        << "  <Item name=\"SCALE\" sample=\"0\" role=\"scale\">"
+                        << scale << "</Item>\n"
+                        << "</GDALMetadata>";
+                    entries.push_back(make_ascii_entry(GDAL_METADATA, ss.str()));
+                }
+                if (has_no_data_value_) {
+                    std::stringstream ss;
+                    ss << std::setprecision(std::numeric_limits<double>::max_digits10)
+                        << no_data_value_;
+                    entries.push_back(make_ascii_entry(GDAL_NODATA, ss.str()));
+                }
+                directories.push_back(std::move(entries));
+            }
+
+            std::vector<char> header;
+            header.push_back(is_little_endian() ? 'I' : 'M');
+            header.push_back(header.back());
+            if (bigtiff_) {
+                append(header, static_cast<std::uint16_t>(43));
+                append(header, static_cast<std::uint16_t>(8));
+                append(header, static_cast<std::uint16_t>(0));
+                append(header, static_cast<std::uint64_t>(16));
+            } else {
+                append(header, static_cast<std::uint16_t>(42));
+                append(header, static_cast<std::uint32_t>(8));
+            }
+
+            // The directories follow each other after the header. Their
+            // sizes do not depend on the positions of the next ones, so
+            // the positions are found by serializing them first without.
+            std::vector<std::uint64_t> ifd_pos {header.size()};
+            std::vector<char> ifd;
+            for (const auto &entries: directories) {
+                serialize_ifd(entries, ifd_pos.back(), 0, bigtiff_, ifd);
+                ifd_pos.push_back(ifd_pos.back() + ifd.size());
+            }
+
+            os_.open(filename_, std::ios::binary | std::ios::trunc);
+            if (!os_) {
+                std::stringstream ss;
+                ss << "Failed to create the file '" << filename_ << "'.";
+                throw std::runtime_error(ss.str());
+            }
+            os_.write(header.data(), static_cast<std::streamsize>(header.size()));
+            for (size_t l = 0; l < levels_.size(); ++l) {
+                const std::vector<Entry> &entries {directories[l]};
+                std::uint64_t next {l + 1 < levels_.size() ? ifd_pos[l + 1] : 0};
+                std::vector<std::uint64_t> value_pos {serialize_ifd(
+                    entries, ifd_pos[l], next, bigtiff_, ifd)};
+                Level &level {levels_[l]};
+                for (size_t i = 0; i < entries.size(); ++i) {
+                    if (entries[i].tag == TILE_OFFSETS) level.offsets_pos = value_pos[i];
+                    if (entries[i].tag == TILE_BYTE_COUNTS) level.sizes_pos = value_pos[i];
+                }
+                os_.write(ifd.data(), static_cast<std::streamsize>(ifd.size()));
+            }
+            header_size_ = ifd_pos.back();
+            end_ = header_size_;
+
+            for (auto &level: levels_) {
+                const size_t n_tiles {static_cast<size_t>(level.n_tx) * level.n_ty};
+                level.tile_offsets.assign(n_tiles, 0);
+                level.tile_sizes.assign(n_tiles, 0);
+                level.strip.resize(static_cast<size_t>(tile_size_) * level.nx * sample_size_);
+            }
+            if (levels_.size() > 1) {
+                // The tiles of the levels are completed in parallel, but a
+                // COG has the tiles of the smallest overview first and the
+                // full resolution ones last, so each level is spooled to a
+                // file of its own until close().
+                for (auto &level: levels_) {
+                    level.spool_file = filename_ + "." +
+                        boost::filesystem::unique_path().string() + ".tmp";
+                    level.spool.open(level.spool_file, std::ios::binary | std::ios::trunc);
+                    if (!level.spool) {
+                        std::stringstream ss;
+                        ss << "Failed to create the file '" << level.spool_file << "'.";
+                        throw std::runtime_error(ss.str());
+                    }
+                }
+            }
+            // The tiles of each row of tiles are compressed by the same
+            // threads for the life of the writer.
+            for (unsigned int i = 0; i < n_threads_; ++i) {
+                workers_.emplace_back(&CogWriter::compress_tiles, this);
+            }
+        }
+
+        CogWriter::~CogWriter()
+        {
+            stop_workers();
+            remove_spools();
+        }
+
+        void CogWriter::remove_spools()
+        {
+            for (auto &level: levels_) {
+                if (level.spool_file.empty()) continue;
+                if (level.spool.is_open()) level.spool.close();
+                boost::system::error_code ec;
+                boost::filesystem::remove(level.spool_file, ec);
+                level.spool_file.clear();
+            }
+        }
+
+        void CogWriter::write_rows(
+            const char * rows,
+            size_t sample_size,
+            unsigned int row_start,
+            unsigned int n_rows)
+        {
+            const Level &level {levels_[0]};
+            if (sample_size != sample_size_) {
+                throw std::runtime_error(
+                    "The rows passed to the GeoTIFF writer are of a wrong type.");
+            }
+            if (row_start != level.next_row || row_start + n_rows > level.ny) {
+                std::stringstream ss;
+                ss << "The rows " << row_start << "-" << (row_start + n_rows - 1)
+                    << " were passed to the GeoTIFF writer when expecting the row "
+                    << level.next_row << ".";
+                throw std::runtime_error(ss.str());
+            }
+            const size_t row_bytes {static_cast<size_t>(level.nx) * sample_size_};
+            for (unsigned int j = 0; j < n_rows; ++j) {
+                add_row(0, rows + j * row_bytes);
+            }
+        }
+
+        void CogWriter::add_row(size_t l, const char * row)
+        {
+            Level &level {levels_[l]};
+            const size_t row_bytes {static_cast<size_t>(level.nx) * sample_size_};
+            std::memcpy(
+                level.strip.data() + (level.next_row % tile_size_) * row_bytes,
+                row,
+                row_bytes);
+            ++level.next_row;
+            const bool last {level.next_row == level.ny};
+            if (level.next_row % tile_size_ == 0 || last) {
+                write_tile_row(level);
+            }
+            if (l + 1 == levels_.size()) return;
+
+            // Reduce each pair of rows to a row of the next level, and the
+            // last row of an odd height alone.
+            std::vector<char> reduced(
+                static_cast<size_t>(levels_[l + 1].nx) * sample_size_);
+            if (level.has_pending) {
+                reduce_rows(level, level.pending.data(), row, reduced.data());
+                level.has_pending = false;
+            } else if (last) {
+                reduce_rows(level, row, row, reduced.data());
+            } else {
+                level.pending.assign(row, row + row_bytes);
+                level.has_pending = true;
+                return;
+            }
+            add_row(l + 1, reduced.data());
+        }
+
+        void CogWriter::reduce_rows(
+            const Level & level,
+            const char * a,
+            const char * b,
+            char * out) const
+        {
+            const bool average {resampling_ == OverviewResampling::AVERAGE};
+            switch (data_type_) {
+                case GDT_Byte:
+                    reduce<std::uint8_t>(a, b, level.nx, average,
+                        has_no_data_value_, no_data_value_, out);
+                    break;
+                case GDT_UInt16:
+                    reduce<std::uint16_t>(a, b, level.nx, average,
+                        has_no_data_value_, no_data_value_, out);
+                    break;
+                case GDT_Int16:
+                    reduce<std::int16_t>(a, b, level.nx, average,
+                        has_no_data_value_, no_data_value_, out);
+                    break;
+                case GDT_UInt32:
+                    reduce<std::uint32_t>(a, b, level.nx, average,
+                        has_no_data_value_, no_data_value_, out);
+                    break;
+                case GDT_Int32:
+                    reduce<std::int32_t>(a, b, level.nx, average,
+                        has_no_data_value_, no_data_value_, out);
+                    break;
+                case GDT_Float32:
+                    reduce<float>(a, b, level.nx, average,
+                        has_no_data_value_, no_data_value_, out);
+                    break;
+                default:
+                    reduce<double>(a, b, level.nx, average,
+                        has_no_data_value_, no_data_value_, out);
+                    break;
+            }
+        }
+
+        void CogWriter::compress_tile(
+            const Level & level,
+            unsigned int tx,
+            std::vector<unsigned char> &out) const
+        {
+            // The rows of the last row of tiles below the image and the
+            // columns of the last column right of it are filled with the
+            // no-data value.
+            const unsigned int row0 {(level.next_row - 1) / tile_size_ * tile_size_};
+            const unsigned int h {level.next_row - row0};
+            const unsigned int col0 {tx * tile_size_};
+            const unsigned int w {std::min(tile_size_, level.nx - col0)};
+            const size_t row_bytes {static_cast<size_t>(tile_size_) * sample_size_};
+            std::vector<char> tile(row_bytes * tile_size_);
+            std::vector<char> tmp;
+            for (unsigned int j = 0; j < tile_size_; ++j) {
+                char *row {tile.data() + j * row_bytes};
+                unsigned int n {j < h ? w : 0};
+                if (n > 0) {
+                    std::memcpy(row,
+                        level.strip.data() +
+                            (static_cast<size_t>(j) * level.nx + col0) * sample_size_,
+                        static_cast<size_t>(n) * sample_size_);
+                }
+                for (unsigned int i = n; i < tile_size_; ++i) {
+                    std::memcpy(row + i * sample_size_, fill_.data(), sample_size_);
+                }
+                if (is_floating_point(data_type_)) {
+                    floating_point_predictor(row, tile_size_, sample_size_, tmp);
+                } else if (sample_size_ == 1) {
+                    horizontal_predictor<std::uint8_t>(row, tile_size_);
+                } else if (sample_size_ == 2) {
+                    horizontal_predictor<std::uint16_t>(row, tile_size_);
+                } else {
+                    horizontal_predictor<std::uint32_t>(row, tile_size_);
+                }
+            }
+            uLongf n {compressBound(static_cast<uLong>(tile.size()))};
+            out.resize(n);
+            if (compress2(out.data(), &n,
+                    reinterpret_cast<const Bytef*>(tile.data()),
+                    static_cast<uLong>(tile.size()),
+                    Z_DEFAULT_COMPRESSION) != Z_OK) {
+                throw std::runtime_error("Failed to compress a tile.");
+            }
+            out.resize(n);
+        }
+
+        void CogWriter::write_tile_row(Level & level)
+        {
+            const unsigned int ty {(level.next_row - 1) / tile_size_};
+            {
+                std::lock_guard<std::mutex> lock {pool_mutex_};
+                if (tiles_.size() < level.n_tx) tiles_.resize(level.n_tx);
+                job_ = &level;
+                next_tile_ = 0;
+                n_done_ = 0;
+                error_ = nullptr;
+            }
+            job_ready_.notify_all();
+            std::exception_ptr error;
+            {
+                std::unique_lock<std::mutex> lock {pool_mutex_};
+                job_done_.wait(lock, [&]() { return n_done_ == level.n_tx; });
+                job_ = nullptr;
+                error = error_;
+            }
+            if (error) std::rethrow_exception(error);
+            const auto &tiles = tiles_;
+
+            // The offsets are relative to the start of the tiles of the
+            // level until close().
+            std::ofstream &os {level.spool.is_open() ? level.spool : os_};
+            for (unsigned int tx = 0; tx < level.n_tx; ++tx) {
+                size_t t {static_cast<size_t>(ty) * level.n_tx + tx};
+                level.tile_offsets[t] = level.data_size;
+                level.tile_sizes[t] = tiles[tx].size();
+                os.write(reinterpret_cast<const char*>(tiles[tx].data()),
+                    static_cast<std::streamsize>(tiles[tx].size()));
+                level.data_size += tiles[tx].size();
+                end_ += tiles[tx].size();
+            }
+            if (!os) {
+                std::stringstream ss;
+                ss << "Failed to write to the file '"
+                    << (level.spool.is_open() ? level.spool_file : filename_) << "'.";
+                throw std::runtime_error(ss.str());
+            }
+            if (!bigtiff_ && end_ > std::numeric_limits<std::uint32_t>::max()) {
+                throw std::runtime_error("The GeoTIFF file grew over 4 GB.");
+            }
+        }
+
+        void CogWriter::compress_tiles()
+        {
+            std::unique_lock<std::mutex> lock {pool_mutex_};
+            for (;;) {
+                job_ready_.wait(lock, [this]() {
+                    return stop_ || (job_ && next_tile_ < job_->n_tx);
+                });
+                if (stop_) return;
+                const Level &level {*job_};
+                const unsigned int tx {next_tile_++};
+                lock.unlock();
+                std::exception_ptr error;
+                try {
+                    compress_tile(level, tx, tiles_[tx]);
+                } catch (...) {
+                    error = std::current_exception();
+                }
+                lock.lock();
+                if (error && !error_) error_ = error;
+                if (++n_done_ == level.n_tx) job_done_.notify_all();
+            }
+        }
+
+        void CogWriter::stop_workers()
+        {
+            {
+                std::lock_guard<std::mutex> lock {pool_mutex_};
+                stop_ = true;
+            }
+            job_ready_.notify_all();
+            for (auto &t: workers_) t.join();
+            workers_.clear();
+        }
+
+        void CogWriter::write_at(std::uint64_t pos, const void *data, size_t n)
+        {
+            os_.seekp(static_cast<std::streamoff>(pos));
+            os_.write(static_cast<const char*>(data), static_cast<std::streamsize>(n));
+        }
+
+        void CogWriter::close()
+        {
+            for (const auto &level: levels_) {
+                if (level.next_row != level.ny) {
+                    std::stringstream ss;
+                    ss << "Only " << levels_[0].next_row << " of the " << levels_[0].ny
+                        << " rows were written to the GeoTIFF file.";
+                    throw std::runtime_error(ss.str());
+                }
+            }
+            // The tiles follow the directories from the smallest overview
+            // to the full resolution image.
+            std::uint64_t pos {header_size_};
+            for (size_t l = levels_.size(); l-- > 0;) {
+                Level &level {levels_[l]};
+                if (level.spool.is_open()) {
+                    level.spool.close();
+                    std::ifstream is {level.spool_file, std::ios::binary};
+                    os_.seekp(static_cast<std::streamoff>(pos));
+                    if (level.data_size > 0) os_ << is.rdbuf();
+                    if (!is || !os_) {
+                        std::stringstream ss;
+                        ss << "Failed to copy the tiles from '" << level.spool_file
+                            << "' to '" << filename_ << "'.";
+                        throw std::runtime_error(ss.str());
+                    }
+                }
+                for (auto &offset: level.tile_offsets) offset += pos;
+                pos += level.data_size;
+            }
+            stop_workers();
+            remove_spools();
+            for (const auto &level: levels_) {
+                if (bigtiff_) {
+                    write_at(level.offsets_pos, level.tile_offsets.data(),
+                        level.tile_offsets.size() * sizeof(std::uint64_t));
+                    write_at(level.sizes_pos, level.tile_sizes.data(),
+                        level.tile_sizes.size() * sizeof(std::uint64_t));
+                } else {
+                    std::vector<std::uint32_t> offsets(
+                        level.tile_offsets.begin(), level.tile_offsets.end());
+                    std::vector<std::uint32_t> sizes(
+                        level.tile_sizes.begin(), level.tile_sizes.end());
+                    write_at(level.offsets_pos, offsets.data(),
+                        offsets.size() * sizeof(std::uint32_t));
+                    write_at(level.sizes_pos, sizes.data(),
+                        sizes.size() * sizeof(std::uint32_t));
+                }
+            }
+            os_.close();
+            if (!os_) {
+                std::stringstream ss;
+                ss << "Failed to write to the file '" << filename_ << "'.";
+                throw std::runtime_error(ss.str());
+            }
+        }
+
+    }
+
+}
@@ -0,0 +1,212 @@
+#ifndef COG_WRITER_H_
+#define COG_WRITER_H_
+
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <gdal_priv.h>
+#include <boost/filesystem.hpp>
+
+#include "framework/RasterArea.h"
+
+namespace io {
+
+    namespace tiff {
+
+        /**
+         * \brief How the pixels of an overview are computed from the 2 x 2
+         * pixels of the level above it.
+         */
+        enum class OverviewResampling {AVERAGE, NEAREST};
+
+        /**
+         * \brief Parse the name of an overview resampling method
+         * ("average" or "nearest").
+         */
+        OverviewResampling overview_resampling_from_string(const std::string &s);
+
+        /**
+         * \brief Write a raster as a tiled, DEFLATE compressed Cloud
+         * Optimized GeoTIFF without going through GDAL.
+         *
+         * The header and the image file directories are written first, with
+         * room for the offsets and the sizes of all the tiles, and the
+         * tiles follow in row-major order. The rows are passed in bands in
+         * the order of the rows; once a row of tiles is complete, its
+         * tiles are compressed by a pool of n_threads threads that lives as
+         * long as the writer and appended to the file, and the offsets are
+         * filled in by close(). Only one row of tiles is in memory at a
+         * time.
+         *
+         * With n_overviews > 0 the overviews reduced by 2, 4, 8, ... are
+         * computed from the rows as they are passed and written as reduced
+         * resolution images after the full resolution one. The tiles of
+         * each level are compressed as soon as their rows of tiles are
+         * complete and spooled to a temporary file next to the output, and
+         * close() copies them to the output in the COG order from the
+         * smallest overview to the full resolution image. The overviews
+         * stop at the first one that fits in a tile.
+         *
+         * The floating point samples are compressed with the floating
+         * point predictor and the integer ones with the horizontal
+         * differencing predictor. The georeferencing is stored in the
+         * GeoTIFF tags with the EPSG code of the reference system, so a
+         * reference system without one is an error. The no-data value is
+         * stored in the GDAL_NODATA tag, and a scale other than 1 or an
+         * offset other than 0 in the GDAL_METADATA tag. A BigTIFF is
+         * written when the file could exceed 4 GB.
+         */
+        class CogWriter
+        {
+            public:
+                template<typename Raster>
+                CogWriter(
+                    Raster & raster,
+                    const boost::filesystem::path & file,
+                    unsigned int n_threads,
+                    unsigned int n_overviews = 0,
+                    OverviewResampling resampling = OverviewResampling::AVERAGE,
+                    unsigned int tile_size = 512):
+                        CogWriter(
+                            file, raster.area(), raster.data_type(),
+                            raster.has_no_data_value(),
+                            raster.has_no_data_value() ?
+                                static_cast<double>(raster.no_data_value()) : 0,
+                            raster.scale(), raster.offset(),
+                            n_threads, n_overviews, resampling, tile_size)
+                {
+                }
+
+                CogWriter(
+                    const boost::filesystem::path & file,
+                    const geo::RasterArea & area,
+                    GDALDataType data_type,
+                    bool has_no_data_value,
+                    double no_data_value,
+                    double scale,
+                    double offset,
+                    unsigned int n_threads,
+                    unsigned int n_overviews,
+                    OverviewResampling resampling,
+                    unsigned int tile_size);
+
+                CogWriter(const CogWriter &) = delete;
+                CogWriter & operator=(const CogWriter &) = delete;
+                ~CogWriter();
+
+                /// The height of the tiles in rows.
+                unsigned int block_height() const { return tile_size_; }
+
+                /**
+                 * \brief Write the n_rows rows starting from row_start,
+                 * which must follow the rows written before.
+                 */
+                template<typename T>
+                void operator()(
+                    const T * rows,
+                    unsigned int row_start,
+                    unsigned int n_rows)
+                {
+                    write_rows(reinterpret_cast<const char*>(rows),
+                        sizeof(T), row_start, n_rows);
+                }
+
+                /**
+                 * \brief Write the tile offsets and close the file. All the
+                 * rows must have been written.
+                 */
+                void close();
+
+            private:
+                /// The full resolution image or one of the overviews.
+                struct Level
+                {
+                    unsigned int nx;
+                    unsigned int ny;
+                    unsigned int n_tx;
+                    unsigned int n_ty;
+                    /// The rows of the current row of tiles.
+                    std::vector<char> strip;
+                    unsigned int next_row;
+                    std::vector<std::uint64_t> tile_offsets;
+                    std::vector<std::uint64_t> tile_sizes;
+                    /// Where in the file the offsets and the sizes of the
+                    /// tiles are stored.
+                    std::uint64_t offsets_pos;
+                    std::uint64_t sizes_pos;
+                    /// A row waiting for the row below it to be reduced to
+                    /// the next level.
+                    std::vector<char> pending;
+                    bool has_pending;
+                    /// The tiles of the level until close() with overviews.
+                    std::string spool_file;
+                    std::ofstream spool;
+                    /// The size of the tiles written so far.
+                    std::uint64_t data_size;
+                };
+
+                std::ofstream os_;
+                std::string filename_;
+                unsigned int tile_size_;
+                unsigned int sample_size_;
+                GDALDataType data_type_;
+                bool has_no_data_value_;
+                double no_data_value_;
+                /// The no-data value, or zero, as the bytes of a sample.
+                std::vector<char> fill_;
+                unsigned int n_threads_;
+                OverviewResampling resampling_;
+                bool bigtiff_;
+                std::vector<Level> levels_;
+                /// The size of the header and the directories.
+                std::uint64_t header_size_;
+                /// The size of the file written so far.
+                std::uint64_t end_;
+
+                /// The threads compressing the tiles of a row of tiles.
+                std::vector<std::thread> workers_;
+                std::mutex pool_mutex_;
+                std::condition_variable job_ready_;
+                std::condition_variable job_done_;
+                /// The level whose row of tiles is being compressed.
+                const Level *job_;
+                unsigned int next_tile_;
+                unsigned int n_done_;
+                /// The compressed tiles of the row of tiles.
+                std::vector<std::vector<unsigned char>> tiles_;
+                std::exception_ptr error_;
+                bool stop_;
+
+                void write_rows(
+                    const char * rows,
+                    size_t sample_size,
+                    unsigned int row_start,
+                    unsigned int n_rows);
+                void add_row(size_t l, const char * row);
+                void reduce_rows(
+                    const Level & level,
+                    const char * a,
+                    const char * b,
+                    char * out) const;
+                void write_tile_row(Level & level);
+                void compress_tile(
+                    const Level & level,
+                    unsigned int tx,
+                    std::vector<unsigned char> &out) const;
+                void compress_tiles();
+                void stop_workers();
+                void write_at(std::uint64_t pos, const void *data, size_t n);
+                void remove_spools();
+        };
+
+    }
+
+}
+
+#endif
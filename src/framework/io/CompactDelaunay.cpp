@@ -0,0 +1,528 @@
+#include "CompactDelaunay.h"
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+#include <sstream>
+#include <stdexcept>
+
+namespace {
+
+    /// The largest quantized coordinate, so that the incircle determinant
+    /// fits in 128 bits.
+    const double max_coordinate {1 << 29};
+
+    /**
+     * \brief The index of the point (x, y) on a Hilbert curve filling the
+     * 2^16 x 2^16 grid.
+     */
+    std::uint32_t hilbert_index(std::uint32_t x, std::uint32_t y)
+    {
+        const std::uint32_t n {1u << 16};
+        std::uint32_t d {0};
+        for (std::uint32_t s = n / 2; s > 0; s /= 2) {
+            std::uint32_t rx {(x & s) > 0 ? 1u : 0u};
+            std::uint32_t ry {(y & s) > 0 ? 1u : 0u};
+            d += s * s * ((3 * rx) ^ ry);
+            if (ry == 0) {
+                if (rx == 1) {
+                    x = n - 1 - x;
+                    y = n - 1 - y;
+                }
+                std::swap(x, y);
+            }
+        }
+        return d;
+    }
+
+}
+
+namespace io {
+
+    namespace point_cloud {
+
+        const std::uint32_t CompactDelaunay::none;
+        const std::uint32_t CompactDelaunay::infinite;
+
+        int CompactDelaunay::Face_handle::index(const Vertex_handle &v) const
+        {
+            const Triangle &t {dt_->triangles_[t_]};
+            if (t.v[0] == v.index()) return 0;
+            if (t.v[1] == v.index()) return 1;
+            return 2;
+        }
+
+        CompactDelaunay::Finite_faces_iterator::Finite_faces_iterator(
+                const CompactDelaunay *dt,
+                std::uint32_t t):
+            dt_ {dt},
+            face_ {dt, t}
+        {
+            skip_infinite();
+        }
+
+        CompactDelaunay::Finite_faces_iterator &
+        CompactDelaunay::Finite_faces_iterator::operator++()
+        {
+            face_ = Face_handle(dt_, face_.index() + 1);
+            skip_infinite();
+            return *this;
+        }
+
+        void CompactDelaunay::Finite_faces_iterator::skip_infinite()
+        {
+            std::uint32_t t {face_.index()};
+            const std::uint32_t n {static_cast<std::uint32_t>(dt_->triangles_.size())};
+            while (t < n && dt_->is_infinite_triangle(t)) ++t;
+            face_ = Face_handle(dt_, t);
+        }
+
+        CompactDelaunay::CompactDelaunay(double scale):
+            scale_ {scale},
+            x_origin_ {0},
+            y_origin_ {0},
+            has_origin_ {false},
+            last_ {0},
+            rng_ {1}
+        {
+            if (scale_ <= 0) {
+                throw std::runtime_error(
+                    "The scale of the compact TIN must be positive.");
+            }
+        }
+
+        void CompactDelaunay::clear()
+        {
+            has_origin_ = false;
+            std::vector<std::int32_t>().swap(X_);
+            std::vector<std::int32_t>().swap(Y_);
+            std::vector<double>().swap(Z_);
+            std::vector<Triangle>().swap(triangles_);
+            last_ = 0;
+        }
+
+        int CompactDelaunay::dimension() const
+        {
+            if (X_.empty()) return -1;
+            if (triangles_.empty()) return X_.size() == 1 ? 0 : 1;
+            return 2;
+        }
+
+        CompactDelaunay::Point CompactDelaunay::point(std::uint32_t v) const
+        {
+            return Point(X_[v] * scale_ + x_origin_, Y_[v] * scale_ + y_origin_);
+        }
+
+        CompactDelaunay::Point CompactDelaunay::to_local(const Point &p) const
+        {
+            return Point((p.x() - x_origin_) / scale_, (p.y() - y_origin_) / scale_);
+        }
+
+        bool CompactDelaunay::is_infinite_triangle(std::uint32_t t) const
+        {
+            const Triangle &tr {triangles_[t]};
+            return tr.v[0] == infinite || tr.v[1] == infinite || tr.v[2] == infinite;
+        }
+
+        bool CompactDelaunay::is_infinite(Face_handle f) const
+        {
+            return f.index() >= triangles_.size() || is_infinite_triangle(f.index());
+        }
+
+        CompactDelaunay::Finite_faces_iterator CompactDelaunay::finite_faces_begin() const
+        {
+            return Finite_faces_iterator(this, 0);
+        }
+
+        CompactDelaunay::Finite_faces_iterator CompactDelaunay::finite_faces_end() const
+        {
+            return Finite_faces_iterator(this,
+                static_cast<std::uint32_t>(triangles_.size()));
+        }
+
+        void CompactDelaunay::add_vertex(const Point &p, double z)
+        {
+            if (!has_origin_) {
+                x_origin_ = std::floor(p.x());
+                y_origin_ = std::floor(p.y());
+                has_origin_ = true;
+            }
+            double X {std::round((p.x() - x_origin_) / scale_)};
+            double Y {std::round((p.y() - y_origin_) / scale_)};
+            if (std::fabs(X) > max_coordinate || std::fabs(Y) > max_coordinate) {
+                std::stringstream ss;
+                ss << "The point (" << p.x() << ", " << p.y() << ", " << z
+                    << ") is out of the range of the compact TIN.";
+                throw std::runtime_error(ss.str());
+            }
+            // Each vertex adds two triangles.
+            if (X_.size() >= (infinite - 4) / 2) {
+                throw std::runtime_error("Too many points for the compact TIN.");
+            }
+            X_.push_back(static_cast<std::int32_t>(X));
+            Y_.push_back(static_cast<std::int32_t>(Y));
+            Z_.push_back(z);
+        }
+
+        bool CompactDelaunay::insert(const Point &p, double z)
+        {
+            add_vertex(p, z);
+            if (!insert_vertex(static_cast<std::uint32_t>(X_.size() - 1))) {
+                X_.pop_back();
+                Y_.pop_back();
+                Z_.pop_back();
+                return false;
+            }
+            return true;
+        }
+
+        size_t CompactDelaunay::insert(
+            const std::vector<Point> &points,
+            const std::vector<double> &z)
+        {
+            if (points.empty()) return 0;
+            // Quantize all the points first to sort them along the curve.
+            CompactDelaunay q {scale_};
+            if (has_origin_) {
+                q.x_origin_ = x_origin_;
+                q.y_origin_ = y_origin_;
+                q.has_origin_ = true;
+            }
+            q.X_.reserve(points.size());
+            q.Y_.reserve(points.size());
+            q.Z_.reserve(points.size());
+            for (size_t i = 0; i < points.size(); ++i) q.add_vertex(points[i], z[i]);
+            x_origin_ = q.x_origin_;
+            y_origin_ = q.y_origin_;
+            has_origin_ = true;
+
+            std::int32_t x_min {*std::min_element(q.X_.begin(), q.X_.end())};
+            std::int32_t y_min {*std::min_element(q.Y_.begin(), q.Y_.end())};
+            std::int32_t x_max {*std::max_element(q.X_.begin(), q.X_.end())};
+            std::int32_t y_max {*std::max_element(q.Y_.begin(), q.Y_.end())};
+            std::uint32_t range {static_cast<std::uint32_t>(
+                std::max(x_max - x_min, y_max - y_min))};
+            int shift {0};
+            while ((range >> shift) >= (1u << 16)) ++shift;
+            std::vector<std::uint32_t> keys(points.size());
+            for (size_t i = 0; i < points.size(); ++i) {
+                keys[i] = hilbert_index(
+                    static_cast<std::uint32_t>(q.X_[i] - x_min) >> shift,
+                    static_cast<std::uint32_t>(q.Y_[i] - y_min) >> shift);
+            }
+            std::vector<std::uint32_t> order(points.size());
+            std::iota(order.begin(), order.end(), 0u);
+            // The earlier of the points in the same cell of the curve is
+            // inserted first, so it is kept if they are duplicates.
+            std::sort(order.begin(), order.end(),
+                [&keys](std::uint32_t a, std::uint32_t b) {
+                    return keys[a] < keys[b] || (keys[a] == keys[b] && a < b);
+                });
+            std::vector<std::uint32_t>().swap(keys);
+
+            X_.reserve(X_.size() + points.size());
+            Y_.reserve(Y_.size() + points.size());
+            Z_.reserve(Z_.size() + points.size());
+            triangles_.reserve(triangles_.size() + 2 * points.size() + 4);
+            size_t n_duplicates {0};
+            for (std::uint32_t i: order) {
+                X_.push_back(q.X_[i]);
+                Y_.push_back(q.Y_[i]);
+                Z_.push_back(q.Z_[i]);
+                if (!insert_vertex(static_cast<std::uint32_t>(X_.size() - 1))) {
+                    X_.pop_back();
+                    Y_.pop_back();
+                    Z_.pop_back();
+                    ++n_duplicates;
+                }
+            }
+            return n_duplicates;
+        }
+
+        int CompactDelaunay::orientation(
+            std::uint32_t a,
+            std::uint32_t b,
+            std::uint32_t c) const
+        {
+            std::int64_t abx {static_cast<std::int64_t>(X_[b]) - X_[a]};
+            std::int64_t aby {static_cast<std::int64_t>(Y_[b]) - Y_[a]};
+            std::int64_t acx {static_cast<std::int64_t>(X_[c]) - X_[a]};
+            std::int64_t acy {static_cast<std::int64_t>(Y_[c]) - Y_[a]};
+            std::int64_t det {abx * acy - aby * acx};
+            return (det > 0) - (det < 0);
+        }
+
+        int CompactDelaunay::incircle(
+            std::uint32_t a,
+            std::uint32_t b,
+            std::uint32_t c,
+            std::uint32_t d) const
+        {
+            std::int64_t adx {static_cast<std::int64_t>(X_[a]) - X_[d]};
+            std::int64_t ady {static_cast<std::int64_t>(Y_[a]) - Y_[d]};
+            std::int64_t bdx {static_cast<std::int64_t>(X_[b]) - X_[d]};
+            std::int64_t bdy {static_cast<std::int64_t>(Y_[b]) - Y_[d]};
+            std::int64_t cdx {static_cast<std::int64_t>(X_[c]) - X_[d]};
+            std::int64_t cdy {static_cast<std::int64_t>(Y_[c]) - Y_[d]};
+            std::int64_t alift {adx * adx + ady * ady};
+            std::int64_t blift {bdx * bdx + bdy * bdy};
+            std::int64_t clift {cdx * cdx + cdy * cdy};
+            __int128 det {static_cast<__int128>(alift) * (bdx * cdy - cdx * bdy)
+                - static_cast<__int128>(blift) * (adx * cdy - cdx * ady)
+                + static_cast<__int128>(clift) * (adx * bdy - bdx * ady)};
+            return (det > 0) - (det < 0);
+        }
+
+        bool CompactDelaunay::in_conflict(std::uint32_t t, std::uint32_t v) const
+        {
+            const Triangle &tr {triangles_[t]};
+            for (int i = 0; i < 3; ++i) {
+                if (tr.v[i] != infinite) continue;
+                // The circumcircle of an infinite triangle is the open half
+                // plane outside of its hull edge and the open edge itself.
+                std::uint32_t a {tr.v[ccw(i)]}, b {tr.v[cw(i)]};
+                int o {orientation(a, b, v)};
+                if (o != 0) return o > 0;
+                std::int64_t vax {static_cast<std::int64_t>(X_[v]) - X_[a]};
+                std::int64_t vay {static_cast<std::int64_t>(Y_[v]) - Y_[a]};
+                std::int64_t vbx {static_cast<std::int64_t>(X_[v]) - X_[b]};
+                std::int64_t vby {static_cast<std::int64_t>(Y_[v]) - Y_[b]};
+                return vax * vbx + vay * vby < 0;
+            }
+            return incircle(tr.v[0], tr.v[1], tr.v[2], v) > 0;
+        }
+
+        bool CompactDelaunay::in_cavity(std::uint32_t t) const
+        {
+            return std::find(cavity_.begin(), cavity_.end(), t) != cavity_.end();
+        }
+
+        void CompactDelaunay::set_neighbor(
+            std::uint32_t t,
+            std::uint32_t a,
+            std::uint32_t b,
+            std::uint32_t n)
+        {
+            Triangle &tr {triangles_[t]};
+            for (int i = 0; i < 3; ++i) {
+                if (tr.v[i] != a && tr.v[i] != b) {
+                    tr.n[i] = n;
+                    return;
+                }
+            }
+        }
+
+        void CompactDelaunay::start_triangulation(std::uint32_t v)
+        {
+            // The earlier vertices are all on the line through the first
+            // two, so those two and v make the first triangle.
+            std::uint32_t a {0}, b {1};
+            if (orientation(a, b, v) < 0) std::swap(a, b);
+            triangles_.push_back({{a, b, v}, {none, none, none}});
+            for (int i = 0; i < 3; ++i) {
+                const Triangle &t {triangles_[0]};
+                triangles_.push_back({{t.v[cw(i)], t.v[ccw(i)], infinite},
+                    {none, none, 0}});
+                triangles_[0].n[i] = static_cast<std::uint32_t>(i + 1);
+            }
+            // The infinite triangles share their edges to the infinite
+            // vertex with each other.
+            for (std::uint32_t t = 1; t < 4; ++t) {
+                for (int i = 0; i < 2; ++i) {
+                    std::uint32_t a_ {triangles_[t].v[ccw(i)]};
+                    std::uint32_t b_ {triangles_[t].v[cw(i)]};
+                    for (std::uint32_t s = 1; s < 4; ++s) {
+                        if (s == t) continue;
+                        const Triangle &o {triangles_[s]};
+                        for (int j = 0; j < 3; ++j) {
+                            if (o.v[ccw(j)] == b_ && o.v[cw(j)] == a_) {
+                                triangles_[t].n[i] = s;
+                            }
+                        }
+                    }
+                }
+            }
+            last_ = 0;
+            for (std::uint32_t u = 2; u < v; ++u) insert_vertex(u);
+        }
+
+        std::uint32_t CompactDelaunay::locate_conflict(std::uint32_t v)
+        {
+            std::uint32_t t {last_};
+            if (is_infinite_triangle(t)) {
+                for (int i = 0; i < 3; ++i) {
+                    if (triangles_[t].v[i] == infinite) {
+                        t = triangles_[t].n[i];
+                        break;
+                    }
+                }
+            }
+            // A visibility walk, starting from a random edge of each
+            // triangle so that it cannot cycle.
+            for (;;) {
+                const Triangle &tr {triangles_[t]};
+                rng_ = rng_ * 1103515245u + 12345u;
+                int start {static_cast<int>((rng_ >> 16) % 3)};
+                bool moved {false};
+                for (int k = 0; k < 3; ++k) {
+                    int i {(start + k) % 3};
+                    if (orientation(tr.v[ccw(i)], tr.v[cw(i)], v) < 0) {
+                        t = tr.n[i];
+                        moved = true;
+                        break;
+                    }
+                }
+                if (!moved) break;
+                // Outside of the convex hull.
+                if (is_infinite_triangle(t)) return t;
+            }
+            for (int i = 0; i < 3; ++i) {
+                if (same_point(triangles_[t].v[i], v)) return none;
+            }
+            return t;
+        }
+
+        bool CompactDelaunay::insert_vertex(std::uint32_t v)
+        {
+            if (triangles_.empty()) {
+                for (std::uint32_t u = 0; u < v; ++u) {
+                    if (same_point(u, v)) return false;
+                }
+                if (v >= 2 && orientation(0, 1, v) != 0) start_triangulation(v);
+                return true;
+            }
+            std::uint32_t seed {locate_conflict(v)};
+            if (seed == none) return false;
+
+            // The triangles whose circumcircle contains v.
+            cavity_.clear();
+            stack_.clear();
+            boundary_.clear();
+            cavity_.push_back(seed);
+            stack_.push_back(seed);
+            while (!stack_.empty()) {
+                std::uint32_t t {stack_.back()};
+                stack_.pop_back();
+                for (int i = 0; i < 3; ++i) {
+                    std::uint32_t n {triangles_[t].n[i]};
+                    if (in_cavity(n)) continue;
+                    if (in_conflict(n, v)) {
+                        cavity_.push_back(n);
+                        stack_.push_back(n);
+                    } else {
+                        boundary_.push_back({triangles_[t].v[ccw(i)],
+                            triangles_[t].v[cw(i)], n});
+                    }
+                }
+            }
+
+            // Connect v to the boundary of the cavity. There are always
+            // two more boundary edges than triangles in the cavity.
+            const size_t m {boundary_.size()};
+            std::vector<std::uint32_t> &created {stack_};
+            for (size_t k = 0; k < m; ++k) {
+                std::uint32_t t;
+                if (k < cavity_.size()) {
+                    t = cavity_[k];
+                } else {
+                    t = static_cast<std::uint32_t>(triangles_.size());
+                    triangles_.push_back({});
+                }
+                const CavityEdge &e {boundary_[k]};
+                triangles_[t] = {{e.a, e.b, v}, {none, none, e.outside}};
+                set_neighbor(e.outside, e.a, e.b, t);
+                created.push_back(t);
+            }
+            for (size_t k = 0; k < m; ++k) {
+                for (size_t l = 0; l < m; ++l) {
+                    if (boundary_[l].a == boundary_[k].b) {
+                        triangles_[created[k]].n[0] = created[l];
+                    }
+                    if (boundary_[l].b == boundary_[k].a) {
+                        triangles_[created[k]].n[1] = created[l];
+                    }
+                }
+            }
+            last_ = created[0];
+            return true;
+        }
+
+        CompactDelaunay::Face_handle CompactDelaunay::locate(
+            const Point &p,
+            Locate_type &lt,
+            int &li,
+            Face_handle hint) const
+        {
+            li = 0;
+            if (dimension() < 2) {
+                lt = OUTSIDE_AFFINE_HULL;
+                return Face_handle();
+            }
+            const Point q {to_local(p)};
+            auto orient = K().orientation_2_object();
+            std::uint32_t t {hint.index() < triangles_.size() ? hint.index() : last_};
+            if (is_infinite_triangle(t)) {
+                for (int i = 0; i < 3; ++i) {
+                    if (triangles_[t].v[i] == infinite) {
+                        t = triangles_[t].n[i];
+                        break;
+                    }
+                }
+            }
+            // The random state is local so that several threads can
+            // locate points at the same time.
+            std::uint32_t rng {t};
+            for (;;) {
+                const Triangle &tr {triangles_[t]};
+                rng = rng * 1103515245u + 12345u;
+                int start {static_cast<int>((rng >> 16) % 3)};
+                bool moved {false};
+                for (int k = 0; k < 3; ++k) {
+                    int i {(start + k) % 3};
+                    if (orient(local_point(tr.v[ccw(i)]), local_point(tr.v[cw(i)]), q) ==
+                        CGAL::CLOCKWISE) {
+                        t = tr.n[i];
+                        moved = true;
+                        break;
+                    }
+                }
+                if (!moved) break;
+                if (is_infinite_triangle(t)) {
+                    lt = OUTSIDE_CONVEX_HULL;
+                    return Face_handle(this, t);
+                }
+            }
+            const Triangle &tr {triangles_[t]};
+            int n_zero {0};
+            int zero[3];
+            for (int i = 0; i < 3; ++i) {
+                if (orient(local_point(tr.v[ccw(i)]), local_point(tr.v[cw(i)]), q) ==
+                    CGAL::COLLINEAR) {
+                    zero[n_zero++] = i;
+                }
+            }
+            if (n_zero == 0) {
+                lt = FACE;
+            } else if (n_zero == 1) {
+                lt = EDGE;
+                li = zero[0];
+            } else {
+                lt = VERTEX;
+                li = 3 - zero[0] - zero[1];
+            }
+            return Face_handle(this, t);
+        }
+
+        CGAL::Oriented_side CompactDelaunay::side_of_oriented_circle(
+            Face_handle f,
+            const Point &p) const
+        {
+            const Triangle &tr {triangles_[f.index()]};
+            return K().side_of_oriented_circle_2_object()(
+                local_point(tr.v[0]), local_point(tr.v[1]),
+                local_point(tr.v[2]), to_local(p));
+        }
+
+    }
+
+}
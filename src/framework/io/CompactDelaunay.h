@@ -0,0 +1,239 @@
+#ifndef COMPACT_DELAUNAY_H_
+#define COMPACT_DELAUNAY_H_
+
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+#include "CountingKernel.h"
+
+namespace io {
+
+    namespace point_cloud {
+
+        /**
+         * \brief A 2D Delaunay triangulation that stores the points as
+         * quantized int32 coordinates.
+         *
+         * The x and y of the points are rounded to multiples of \a scale
+         * from an origin set by the first point and kept in separate
+         * arrays, and the elevations are kept as they are. Each triangle
+         * is three vertex indices and three neighbor indices, and the
+         * convex hull is closed with triangles through an infinite vertex,
+         * so a point takes about 64 bytes in all. The points are inserted
+         * with the Bowyer-Watson algorithm using exact integer orientation
+         * and incircle predicates.
+         *
+         * The queries have the same interface as CGAL's
+         * Delaunay_triangulation_2 as far as the interpolation uses it.
+         * The handles refer to the triangulation, so they must not be used
+         * after it has been destroyed.
+         */
+        class CompactDelaunay
+        {
+            public:
+                using K = CountingKernel;
+                using Point = K::Point_2;
+
+                enum Locate_type {VERTEX = 0, EDGE, FACE, OUTSIDE_CONVEX_HULL,
+                    OUTSIDE_AFFINE_HULL};
+
+                /// The elevation of a vertex.
+                struct Info
+                {
+                    double z;
+                };
+
+                class Vertex_handle
+                {
+                    public:
+                        Vertex_handle(): dt_ {nullptr}, v_ {none}
+                        {
+                        }
+
+                        Vertex_handle(const CompactDelaunay *dt, std::uint32_t v):
+                            dt_ {dt}, v_ {v}
+                        {
+                        }
+
+                        const Vertex_handle * operator->() const { return this; }
+                        Point point() const { return dt_->point(v_); }
+                        Info info() const { return Info {dt_->z(v_)}; }
+                        std::uint32_t index() const { return v_; }
+
+                        bool operator==(const Vertex_handle &o) const { return v_ == o.v_; }
+                        bool operator!=(const Vertex_handle &o) const { return v_ != o.v_; }
+
+                    private:
+                        const CompactDelaunay *dt_;
+                        std::uint32_t v_;
+                };
+
+                class Face_handle
+                {
+                    public:
+                        Face_handle(): dt_ {nullptr}, t_ {none}
+                        {
+                        }
+
+                        Face_handle(const CompactDelaunay *dt, std::uint32_t t):
+                            dt_ {dt}, t_ {t}
+                        {
+                        }
+
+                        const Face_handle * operator->() const { return this; }
+                        Vertex_handle vertex(int i) const
+                        {
+                            return Vertex_handle(dt_, dt_->triangles_[t_].v[i]);
+                        }
+                        Face_handle neighbor(int i) const
+                        {
+                            return Face_handle(dt_, dt_->triangles_[t_].n[i]);
+                        }
+                        int index(const Vertex_handle &v) const;
+                        std::uint32_t index() const { return t_; }
+
+                        bool operator==(const Face_handle &o) const { return t_ == o.t_; }
+                        bool operator!=(const Face_handle &o) const { return t_ != o.t_; }
+
+                    private:
+                        const CompactDelaunay *dt_;
+                        std::uint32_t t_;
+                };
+
+                class Finite_faces_iterator
+                {
+                    public:
+                        Finite_faces_iterator(const CompactDelaunay *dt, std::uint32_t t);
+
+                        const Face_handle * operator->() const { return &face_; }
+                        const Face_handle & operator*() const { return face_; }
+                        operator Face_handle() const { return face_; }
+                        Finite_faces_iterator & operator++();
+                        bool operator==(const Finite_faces_iterator &o) const { return face_ == o.face_; }
+                        bool operator!=(const Finite_faces_iterator &o) const { return face_ != o.face_; }
+
+                    private:
+                        const CompactDelaunay *dt_;
+                        Face_handle face_;
+
+                        void skip_infinite();
+                };
+
+                /**
+                 * \brief The x and y are rounded to multiples of scale. The
+                 * points must be within 2^29 * scale of the first point.
+                 */
+                explicit CompactDelaunay(double scale = 0.001);
+
+                /**
+                 * \brief Insert the point with the elevation z. Return
+                 * false if there already was a point with the same
+                 * quantized x and y, in which case the old elevation is
+                 * kept.
+                 */
+                bool insert(const Point &p, double z);
+
+                /**
+                 * \brief Insert the points with the elevations z in the
+                 * order of a Hilbert curve. Of the points with the same
+                 * quantized x and y the earliest one is kept. Return the
+                 * number of the points ignored.
+                 */
+                size_t insert(const std::vector<Point> &points, const std::vector<double> &z);
+
+                void clear();
+
+                int dimension() const;
+                size_t number_of_vertices() const { return X_.size(); }
+
+                Face_handle locate(const Point &p, Locate_type &lt, int &li,
+                    Face_handle hint = Face_handle()) const;
+                /**
+                 * \brief The side of the circumcircle of the finite face f
+                 * where the point p is, ON_POSITIVE_SIDE inside.
+                 */
+                CGAL::Oriented_side side_of_oriented_circle(Face_handle f, const Point &p) const;
+
+                bool is_infinite(Face_handle f) const;
+                bool is_infinite(Vertex_handle v) const { return v.index() == infinite; }
+
+                Finite_faces_iterator finite_faces_begin() const;
+                Finite_faces_iterator finite_faces_end() const;
+
+                static int ccw(int i) { return i == 2 ? 0 : i + 1; }
+                static int cw(int i) { return i == 0 ? 2 : i - 1; }
+
+            private:
+                static const std::uint32_t none {std::numeric_limits<std::uint32_t>::max()};
+                static const std::uint32_t infinite {none - 1};
+
+                /// The vertices counterclockwise and the neighbor opposite
+                /// to each vertex.
+                struct Triangle
+                {
+                    std::uint32_t v[3];
+                    std::uint32_t n[3];
+                };
+
+                /// An edge of the boundary of the cavity, from a to b
+                /// counterclockwise, with the triangle outside of it.
+                struct CavityEdge
+                {
+                    std::uint32_t a;
+                    std::uint32_t b;
+                    std::uint32_t outside;
+                };
+
+                double scale_;
+                double x_origin_;
+                double y_origin_;
+                bool has_origin_;
+                std::vector<std::int32_t> X_;
+                std::vector<std::int32_t> Y_;
+                std::vector<double> Z_;
+                std::vector<Triangle> triangles_;
+                /// A triangle to start the point location from.
+                std::uint32_t last_;
+                std::uint32_t rng_;
+                std::vector<std::uint32_t> cavity_;
+                std::vector<std::uint32_t> stack_;
+                std::vector<CavityEdge> boundary_;
+
+                friend class Finite_faces_iterator;
+
+                Point point(std::uint32_t v) const;
+                double z(std::uint32_t v) const { return Z_[v]; }
+                Point local_point(std::uint32_t v) const
+                {
+                    return Point(X_[v], Y_[v]);
+                }
+                Point to_local(const Point &p) const;
+                bool is_infinite_triangle(std::uint32_t t) const;
+
+                void add_vertex(const Point &p, double z);
+                bool insert_vertex(std::uint32_t v);
+                void start_triangulation(std::uint32_t v);
+                std::uint32_t locate_conflict(std::uint32_t v);
+                bool in_conflict(std::uint32_t t, std::uint32_t v) const;
+                bool in_cavity(std::uint32_t t) const;
+                int orientation(std::uint32_t a, std::uint32_t b, std::uint32_t c) const;
+                int incircle(std::uint32_t a, std::uint32_t b, std::uint32_t c,
+                    std::uint32_t d) const;
+                bool same_point(std::uint32_t a, std::uint32_t b) const
+                {
+                    return X_[a] == X_[b] && Y_[a] == Y_[b];
+                }
+                /**
+                 * \brief Set the neighbor of the triangle t across its edge
+                 * from b to a to the triangle n.
+                 */
+                void set_neighbor(std::uint32_t t, std::uint32_t a, std::uint32_t b,
+                    std::uint32_t n);
+        };
+
+    }
+
+}
+
+#endif
@@ -0,0 +1,79 @@
+#include "CountingKernel.h"
+
+#include <atomic>
+#include <cmath>
+#include <limits>
+
+namespace {
+
+    std::atomic<std::uint64_t> n_exact_predicates {0};
+
+    /// Half of the machine epsilon, the relative error of a rounding.
+    const double eps {std::numeric_limits<double>::epsilon() / 2};
+    /// The error bounds of the double precision determinants relative
+    /// to their permanents, from Shewchuk's robust predicates.
+    const double orientation_bound {(3 + 16 * eps) * eps};
+    const double incircle_bound {(10 + 96 * eps) * eps};
+
+}
+
+namespace io {
+
+    namespace point_cloud {
+
+        std::uint64_t number_of_exact_predicates()
+        {
+            return n_exact_predicates.load(std::memory_order_relaxed);
+        }
+
+        CountingKernel::Orientation_2::result_type
+        CountingKernel::Orientation_2::operator()(
+            const Point_2 &p,
+            const Point_2 &q,
+            const Point_2 &r) const
+        {
+            double left {(p.x() - r.x()) * (q.y() - r.y())};
+            double right {(p.y() - r.y()) * (q.x() - r.x())};
+            double det {left - right};
+            double bound {orientation_bound * (std::fabs(left) + std::fabs(right))};
+            if (det > bound) return CGAL::POSITIVE;
+            if (-det > bound) return CGAL::NEGATIVE;
+            n_exact_predicates.fetch_add(1, std::memory_order_relaxed);
+            return Base().orientation_2_object()(p, q, r);
+        }
+
+        CountingKernel::Side_of_oriented_circle_2::result_type
+        CountingKernel::Side_of_oriented_circle_2::operator()(
+            const Point_2 &p,
+            const Point_2 &q,
+            const Point_2 &r,
+            const Point_2 &t) const
+        {
+            double adx {p.x() - t.x()}, ady {p.y() - t.y()};
+            double bdx {q.x() - t.x()}, bdy {q.y() - t.y()};
+            double cdx {r.x() - t.x()}, cdy {r.y() - t.y()};
+
+            double bdxcdy {bdx * cdy}, cdxbdy {cdx * bdy};
+            double cdxady {cdx * ady}, adxcdy {adx * cdy};
+            double adxbdy {adx * bdy}, bdxady {bdx * ady};
+            double alift {adx * adx + ady * ady};
+            double blift {bdx * bdx + bdy * bdy};
+            double clift {cdx * cdx + cdy * cdy};
+
+            double det {alift * (bdxcdy - cdxbdy) +
+                blift * (cdxady - adxcdy) +
+                clift * (adxbdy - bdxady)};
+            double permanent {
+                (std::fabs(bdxcdy) + std::fabs(cdxbdy)) * alift +
+                (std::fabs(cdxady) + std::fabs(adxcdy)) * blift +
+                (std::fabs(adxbdy) + std::fabs(bdxady)) * clift};
+            double bound {incircle_bound * permanent};
+            if (det > bound) return CGAL::ON_POSITIVE_SIDE;
+            if (-det > bound) return CGAL::ON_NEGATIVE_SIDE;
+            n_exact_predicates.fetch_add(1, std::memory_order_relaxed);
+            return Base().side_of_oriented_circle_2_object()(p, q, r, t);
+        }
+
+    }
+
+}
@@ -0,0 +1,72 @@
+#ifndef COUNTING_KERNEL_H_
+#define COUNTING_KERNEL_H_
+
+#include <CGAL/Exact_predicates_inexact_constructions_kernel.h>
+
+#include <cstdint>
+
+namespace io {
+
+    namespace point_cloud {
+
+        /**
+         * \brief Return the number of the orientation and incircle tests
+         * of CountingKernel that needed more than double precision since
+         * the start of the program.
+         */
+        std::uint64_t number_of_exact_predicates();
+
+        /**
+         * \brief The Epick kernel with its orientation and incircle
+         * predicates behind a semi-static filter that counts its failures.
+         *
+         * The filter evaluates the determinant in double precision and
+         * accepts its sign if it is larger than Shewchuk's error bound.
+         * Otherwise the predicate of the Epick kernel is called, which
+         * goes on to interval and finally to exact arithmetic, and the
+         * call is counted. The counter is shared by all the threads.
+         */
+        class CountingKernel: public CGAL::Exact_predicates_inexact_constructions_kernel
+        {
+            public:
+                using Base = CGAL::Exact_predicates_inexact_constructions_kernel;
+
+                class Orientation_2
+                {
+                    public:
+                        using result_type = CGAL::Orientation;
+
+                        result_type operator()(
+                            const Point_2 &p,
+                            const Point_2 &q,
+                            const Point_2 &r) const;
+                };
+
+                class Side_of_oriented_circle_2
+                {
+                    public:
+                        using result_type = CGAL::Oriented_side;
+
+                        result_type operator()(
+                            const Point_2 &p,
+                            const Point_2 &q,
+                            const Point_2 &r,
+                            const Point_2 &t) const;
+                };
+
+                Orientation_2 orientation_2_object() const
+                {
+                    return Orientation_2();
+                }
+
+                Side_of_oriented_circle_2 side_of_oriented_circle_2_object() const
+                {
+                    return Side_of_oriented_circle_2();
+                }
+        };
+
+    }
+
+}
+
+#endif
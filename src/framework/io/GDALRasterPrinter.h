@@ -41,6 +41,16 @@ namespace io {
                             << "the created data set." << std::endl;
                 }
             }
+            if (container.scale() != 1 || container.offset() != 0)
+            {
+                GDALRasterBand * band = ds->GetRasterBand(1);
+                if (band->SetScale(container.scale()) == CE_Failure ||
+                    band->SetOffset(container.offset()) == CE_Failure)
+                {
+                        std::cout << "Failed to set the scale and the offset "
+                            << "of the created data set." << std::endl;
+                }
+            }
             return ds;
         }
 
@@ -64,6 +74,70 @@ namespace io {
                 GDAL::RW_MODE::WRITE);
         }
 
+        /**
+         * \brief Write a raster to a new file band by band, so that the
+         * whole raster never needs to be in memory.
+         *
+         * The file is created with the area and the no-data value of the
+         * raster, whose data need not be allocated. Each band of rows is
+         * written through the GDAL blocks, which are flushed to the file
+         * and dropped from the block cache right away. The bands should
+         * be multiples of block_height() rows so that no block is written
+         * twice.
+         */
+        template<typename T>
+        class RasterBandWriter
+        {
+            public:
+                template<typename Raster>
+                RasterBandWriter(
+                    Raster & raster,
+                    const boost::filesystem::path &file,
+                    const std::string & format):
+                        ds_ {create_data_file(
+                            file, format.c_str(), raster, raster.area())},
+                        band_ {ds_->GetRasterBand(1)},
+                        area_ {raster.area()}
+                {
+                }
+
+                /// The height of the blocks of the file in rows.
+                unsigned int block_height() const
+                {
+                    int bsize_x, bsize_y;
+                    band_->GetBlockSize(&bsize_x, &bsize_y);
+                    return static_cast<unsigned int>(bsize_y);
+                }
+
+                /**
+                 * \brief Write the n_rows rows of the raster starting from
+                 * row_start.
+                 */
+                void operator()(
+                    const T * rows,
+                    unsigned int row_start,
+                    unsigned int n_rows)
+                {
+                    geo::RasterArea rows_area {area_.sub_area(
+                        coordinates::RasterCoordinate {0, row_start},
+                        coordinates::RasterDims {area_.pixel_width(), n_rows})};
+                    // array_file_rw_() does not modify the array when
+                    // writing.
+                    GDAL::array_file_rw(
+                        const_cast<T*>(rows),
+                        rows_area,
+                        band_,
+                        GDAL::RW_MODE::WRITE,
+                        row_start);
+                    band_->FlushCache();
+                }
+
+            private:
+                dataset_ptr ds_;
+                GDALRasterBand * band_;
+                geo::RasterArea area_;
+        };
+
     }
 
 }
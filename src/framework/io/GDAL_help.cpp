@@ -1,5 +1,7 @@
 #include "GDAL_help.h"
 
+#include <algorithm>
+#include <cstring>
 #include <sstream>
 
 #include "framework/RasterArea.h"
@@ -47,7 +49,8 @@ namespace io {
             const geo::RasterArea & area,
             GDALDataType value_type,
             GDALRasterBand * band,
-            RW_MODE mode)
+            RW_MODE mode,
+            unsigned int row_offset)
         {
             int bsize_x, bsize_y;
             band->GetBlockSize(&bsize_x, &bsize_y);
@@ -58,12 +61,15 @@ namespace io {
             const int n_blocks_y {
                 (band->GetYSize() + bsize_y - 1) / bsize_y};
 
+            // The array holds the file rows [fy_min, fy_max).
+            const unsigned int fy_min {row_offset};
+
             const unsigned int x_block_min {0};
-            const unsigned int y_block_min {0};
+            const unsigned int y_block_min {fy_min / bsize_y_u};
 
             // Maximum file coordinates (exclusive)
             const unsigned int fx_max {area.pixel_width()};
-            const unsigned int fy_max {area.pixel_height()};
+            const unsigned int fy_max {row_offset + area.pixel_height()};
 
             const unsigned int x_block_max {std::min(
                 static_cast<unsigned int>(n_blocks_x),
@@ -72,14 +78,26 @@ namespace io {
                 static_cast<unsigned int>(n_blocks_y),
                 (fy_max + bsize_y_u - 1) / bsize_y_u)};
 
+            const auto bytesize {static_cast<unsigned int>(
+                #if GDAL_VERSION_MINOR < 2
+                GDALGetDataTypeSize(value_type) / 8
+                #else
+                GDALGetDataTypeSizeBytes(value_type)
+                #endif
+                )};
+
             for (unsigned int y_block = y_block_min; y_block < y_block_max; ++y_block) {
+                // The rows of the block inside of the array.
+                const unsigned int by_min {std::max(y_block * bsize_y_u, fy_min)};
+                const unsigned int by_max {std::min((y_block + 1) * bsize_y_u, fy_max)};
                 for (unsigned int x_block = x_block_min; x_block < x_block_max; ++x_block) {
+                    // A block written over completely need not be read
+                    // first.
                     bool overwrite_old_data {
                         mode == RW_MODE::WRITE &&
-                        x_block > x_block_min &&
-                        x_block < (x_block_max - 1) &&
-                        y_block > y_block_min &&
-                        y_block < (y_block_max - 1)};
+                        (x_block + 1) * bsize_x_u <= fx_max &&
+                        by_min == y_block * bsize_y_u &&
+                        by_max == (y_block + 1) * bsize_y_u};
 
                     GDAL_blockref_guard block {
                         band,
@@ -88,42 +106,28 @@ namespace io {
                         overwrite_old_data};
 
                     unsigned int bx_max {bsize_x_u};
-                    unsigned int by_max {bsize_y_u};
 
                     // Again, ignore the area of the block that is outside
                     // of the active area.
                     if (fx_max < ((x_block + 1) * bsize_x_u)) {
                         bx_max -= (x_block + 1) * bsize_x_u - fx_max;
                     }
-                    if (fy_max < ((y_block + 1) * bsize_y_u)) {
-                        by_max -= (y_block + 1) * bsize_y_u - fy_max;
-                    }
                     const unsigned int width {bx_max};
-                    const unsigned int height {by_max};
 
                     // file coordinates
                     const unsigned int fx_min {
                         x_block * bsize_x_u};
-                    const unsigned int fy_min {
-                        y_block * bsize_y_u};
 
                     // array coordinates
                     const unsigned int ax_min {fx_min};
-                    const unsigned int ay_min {fy_min};
-
-                    const auto bytesize {static_cast<unsigned int>(
-                        #if GDAL_VERSION_MINOR < 2
-                        GDALGetDataTypeSize(value_type) / 8
-                        #else
-                        GDALGetDataTypeSizeBytes(value_type)
-                        #endif
-                        )};
 
                     char * block_data = reinterpret_cast<char*>(
                         block->GetDataRef());
-                    for (unsigned int row = 0; row < height; ++row) {
-                        size_t arr_off {((ay_min + row) * area.pixel_width() + ax_min) * bytesize};
-                        size_t b_off {(row * bsize_x_u) * bytesize};
+                    for (unsigned int fy = by_min; fy < by_max; ++fy) {
+                        size_t arr_off {(static_cast<size_t>(fy - fy_min) *
+                            area.pixel_width() + ax_min) * bytesize};
+                        size_t b_off {(static_cast<size_t>(fy - y_block * bsize_y_u) *
+                            bsize_x_u) * bytesize};
                         size_t w {width * bytesize};
                         if (mode == RW_MODE::READ) {
                             memcpy(array + arr_off, block_data + b_off, w);
@@ -160,12 +164,12 @@ namespace io {
 
         template<> GDALDataType toGDALDataType<unsigned int>()
         {
-            return GDALDataType::GDT_Int32;
+            return GDALDataType::GDT_UInt32;
         }
 
         template<> GDALDataType toGDALDataType<int>()
         {
-            return GDALDataType::GDT_UInt32;
+            return GDALDataType::GDT_Int32;
         }
 
         template<> GDALDataType toGDALDataType<float>()
@@ -173,6 +177,11 @@ namespace io {
             return GDALDataType::GDT_Float32;
         }
 
+        template<> GDALDataType toGDALDataType<double>()
+        {
+            return GDALDataType::GDT_Float64;
+        }
+
     }
 
 }
@@ -18,12 +18,20 @@ namespace io {
             WRITE
         };
 
+        /**
+         * \brief Copy the array from or to the blocks of the band.
+         *
+         * The array has the width of \a array_area and holds its
+         * pixel_height() rows starting from the row \a row_offset of the
+         * band.
+         */
         void array_file_rw_(
             char * array,
             const geo::RasterArea & array_area,
             GDALDataType value_type,
             GDALRasterBand *,
-            RW_MODE mode);
+            RW_MODE mode,
+            unsigned int row_offset);
 
         template<typename T>
         GDALDataType toGDALDataType();
@@ -33,14 +41,16 @@ namespace io {
             T * array,
             const geo::RasterArea & array_area,
             GDALRasterBand * band,
-            RW_MODE mode)
+            RW_MODE mode,
+            unsigned int row_offset = 0)
         {
             array_file_rw_(
                 reinterpret_cast<char*>(array),
                 array_area,
                 toGDALDataType<T>(),
                 band,
-                mode);
+                mode,
+                row_offset);
         }
 
         template<typename T>
@@ -56,6 +66,7 @@ namespace io {
         template<> GDALDataType toGDALDataType<int>();
         template<> GDALDataType toGDALDataType<unsigned int>();
         template<> GDALDataType toGDALDataType<float>();
+        template<> GDALDataType toGDALDataType<double>();
 
     }
 
@@ -1,11 +1,50 @@
 #include "Interpolator.h"
 
+#include <atomic>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+
+namespace {
+
+    std::atomic<std::uint64_t> n_clamped_values {0};
+
+}
+
 namespace io {
 
     namespace point_cloud {
 
+        std::uint64_t number_of_clamped_values()
+        {
+            return n_clamped_values.load(std::memory_order_relaxed);
+        }
+
+        void Interpolator::count_clamped_value()
+        {
+            n_clamped_values.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        InterpolationMethod interpolation_method_from_string(
+            const std::string &s)
+        {
+            if (s == "natural-neighbor") return InterpolationMethod::NATURAL_NEIGHBOR;
+            if (s == "tin-linear") return InterpolationMethod::TIN_LINEAR;
+            std::stringstream ss;
+            ss << "Unknown interpolation method '" << s << "'.";
+            throw std::runtime_error(ss.str());
+        }
+
         Interpolator::Interpolator():
-            tin_ptr_ {new TIN()}
+            tin_ptr_ {new TIN()},
+            n_duplicates_ {0},
+            bulk_ {false},
+            tin_threads_ {1},
+            x_origin_ {0},
+            y_origin_ {0},
+            has_origin_ {false},
+            value_scale_ {1},
+            value_offset_ {0}
         {
         }
 
@@ -18,35 +57,150 @@ namespace io {
             return tin_ptr_->number_of_points();
         }
 
-        Interpolator::Interpolator(Interpolator &&ip)
+        Interpolator::Interpolator(Interpolator &&ip):
+            n_duplicates_ {0},
+            bulk_ {false},
+            tin_threads_ {1},
+            x_origin_ {0},
+            y_origin_ {0},
+            has_origin_ {false},
+            value_scale_ {1},
+            value_offset_ {0}
         {
             std::swap(tin_ptr_, ip.tin_ptr_);
-            std::swap(function_values_, ip.function_values_);
+            std::swap(thinner_, ip.thinner_);
+            std::swap(n_duplicates_, ip.n_duplicates_);
+            std::swap(bulk_, ip.bulk_);
+            std::swap(tin_threads_, ip.tin_threads_);
+            std::swap(pending_points_, ip.pending_points_);
+            std::swap(pending_values_, ip.pending_values_);
+            std::swap(x_origin_, ip.x_origin_);
+            std::swap(y_origin_, ip.y_origin_);
+            std::swap(has_origin_, ip.has_origin_);
+            std::swap(value_scale_, ip.value_scale_);
+            std::swap(value_offset_, ip.value_offset_);
+        }
+
+        void Interpolator::set_origin(double x, double y)
+        {
+            if (number_of_points() > 0 || !pending_points_.empty()) {
+                throw std::runtime_error(
+                    "The origin of the TIN must be set before inserting the points.");
+            }
+            x_origin_ = std::floor(x);
+            y_origin_ = std::floor(y);
+            has_origin_ = true;
+        }
+
+        void Interpolator::set_value_scale(double scale, double offset)
+        {
+            if (scale == 0) {
+                throw std::runtime_error("The scale of the values must not be 0.");
+            }
+            value_scale_ = scale;
+            value_offset_ = offset;
         }
 
         void Interpolator::insert_point(const geo::GeoCoordinate &p, Coord_type elev)
         {
-            TIN::Point p2(p.x(), p.y());
-            tin_ptr_->insert_point(p2);
-            function_values_.insert(std::make_pair(p2, elev));
+            if (thinner_) {
+                thinner_->insert_point(p, elev);
+                return;
+            }
+            if (!has_origin_) set_origin(p.x(), p.y());
+            TIN::Point p2 {to_local(p.x(), p.y())};
+            if (bulk_) {
+                pending_points_.push_back(p2);
+                pending_values_.push_back(elev);
+                return;
+            }
+            if (!tin_ptr_->insert_point(p2, elev)) ++n_duplicates_;
+        }
+
+        void Interpolator::set_bulk_insertion(bool bulk)
+        {
+            if (!bulk) insert_pending_points();
+            bulk_ = bulk;
+        }
+
+        void Interpolator::reserve(size_t n)
+        {
+            if (!bulk_) return;
+            pending_points_.reserve(n);
+            pending_values_.reserve(n);
+        }
+
+        void Interpolator::insert_pending_points()
+        {
+            if (pending_points_.empty()) return;
+            std::cout << "Building the TIN from " << pending_points_.size()
+                << " points." << std::endl;
+            n_duplicates_ += tin_ptr_->insert_points(
+                pending_points_, pending_values_, tin_threads_);
+            std::vector<TIN::Point>().swap(pending_points_);
+            std::vector<Coord_type>().swap(pending_values_);
+        }
+
+        void Interpolator::set_thinning(ThinningPolicy policy, double cell_size)
+        {
+            if (policy == ThinningPolicy::NONE) {
+                thinner_.reset();
+            } else {
+                thinner_.reset(new PointThinner(policy, cell_size));
+            }
+        }
+
+        void Interpolator::finish_insertion()
+        {
+            if (thinner_) {
+                // Release the thinner first so that the kept points go to
+                // the TIN.
+                std::unique_ptr<PointThinner> thinner;
+                std::swap(thinner, thinner_);
+                thinner->insert_to(*this);
+            }
+            insert_pending_points();
+        }
+
+        std::vector<std::vector<Interpolator::Face_handle>> Interpolator::faces_by_band(
+            double upper_left_y,
+            double resolution,
+            unsigned int band_height,
+            unsigned int ny) const
+        {
+            const double y0 {upper_left_y - y_origin_};
+            const unsigned int n_bands {(ny + band_height - 1) / band_height};
+            std::vector<std::vector<Face_handle>> bands(n_bands);
+            const TIN::Delaunay_triangulation &T {tin_ptr_->T_};
+            for (auto f = T.finite_faces_begin(); f != T.finite_faces_end(); ++f) {
+                double min_y {std::min({f->vertex(0)->point().y(),
+                    f->vertex(1)->point().y(), f->vertex(2)->point().y()})};
+                double max_y {std::max({f->vertex(0)->point().y(),
+                    f->vertex(1)->point().y(), f->vertex(2)->point().y()})};
+                // The rows of the pixel centers within the y extent.
+                double j_first {std::max(0.0, std::ceil((y0 - max_y) / resolution))};
+                double j_last {std::min(static_cast<double>(ny) - 1,
+                    std::floor((y0 - min_y) / resolution))};
+                if (j_first > j_last) continue;
+                unsigned int b_first {static_cast<unsigned int>(j_first) / band_height};
+                unsigned int b_last {static_cast<unsigned int>(j_last) / band_height};
+                for (unsigned int b = b_first; b <= b_last; ++b) {
+                    bands[b].push_back(f);
+                }
+            }
+            return bands;
         }
 
         double Interpolator::get_value_at(const geo::GeoCoordinate &p, bool safe) const
         {
-            return get_value_at(TIN::Point(p.x(), p.y()), safe);
+            return get_value_at(to_local(p.x(), p.y()), safe);
         }
 
         double Interpolator::get_value_at(const TIN::Point &p, bool /*safe*/) const
         {
-            typedef CGAL::Data_access< std::map<TIN::Point, Coord_type, TIN::K::Less_xy_2 > >
-                Value_access;
-            std::vector< std::pair< TIN::Point, Coord_type > > coords;
-            Coord_type norm =
-                CGAL::natural_neighbor_coordinates_2
-                (tin_ptr_->T_, p, std::back_inserter(coords)).second;
-            Coord_type res = CGAL::linear_interpolation(
-                coords.begin(), coords.end(), norm, Value_access(function_values_));
-            return res;
+            Kernel kernel;
+            kernel.compute(tin_ptr_->T_, p, Face_handle());
+            return interpolate(kernel.neighbors(), kernel.norm());
         }
 
     }
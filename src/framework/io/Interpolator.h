@@ -1,10 +1,16 @@
 #ifndef INTERPOLATOR_H_
 #define INTERPOLATOR_H_
 
-#include <CGAL/Interpolation_traits_2.h>
-#include <CGAL/natural_neighbor_coordinates_2.h>
-#include <CGAL/interpolation_functions.h>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <type_traits>
+#include <vector>
 
+#include "NaturalNeighborKernel.h"
+#include "PointThinner.h"
 #include "TIN.h"
 #include "framework/coordinates.h"
 #include "framework/geo.h"
@@ -13,21 +19,99 @@ namespace io {
 
     namespace point_cloud {
 
+        /**
+         * \brief The method used to interpolate the raster from the TIN.
+         */
+        enum class InterpolationMethod {NATURAL_NEIGHBOR, TIN_LINEAR};
+
+        /**
+         * \brief Parse the name of an interpolation method
+         * ("natural-neighbor" or "tin-linear").
+         */
+        InterpolationMethod interpolation_method_from_string(
+            const std::string &s);
+
+        /**
+         * \brief Return the number of the interpolated values that were
+         * clamped to the range of an integer value type since the start of
+         * the program.
+         */
+        std::uint64_t number_of_clamped_values();
+
         class Interpolator
         {
             public:
                 using Coord_type = TIN::K::FT;
-                using Traits = CGAL::Interpolation_traits_2<TIN::K>;
+                /// A natural neighbor and its coordinate.
+                using Neighbor = std::pair<TIN::Vertex_handle, Coord_type>;
+                using Face_handle = TIN::Delaunay_triangulation::Face_handle;
+                using Kernel = NaturalNeighborKernel<TIN::Delaunay_triangulation>;
 
                 Interpolator();
                 virtual ~Interpolator();
                 Interpolator(const Interpolator &) = delete;
                 Interpolator(Interpolator &&);
 
+                /**
+                 * \brief Store the points in the TIN relative to the
+                 * point (x, y) rounded down to whole units, so that the
+                 * coordinates in the predicates are small and the
+                 * translation is exact. Must be called before inserting
+                 * any points; by default the origin is set from the first
+                 * point inserted.
+                 */
+                void set_origin(double x, double y);
+
+                /**
+                 * \brief Store the elevation z in the arrays as
+                 * (z - offset) / scale, rounded for the integer types. By
+                 * default the scale is 1 and the offset 0.
+                 */
+                void set_value_scale(double scale, double offset);
+
                 void insert_point(const geo::GeoCoordinate &, Coord_type elev);
                 double get_value_at(const geo::GeoCoordinate &, bool = true) const;
                 size_t number_of_points() const;
 
+                /**
+                 * \brief Thin the points before adding them to the TIN.
+                 *
+                 * The inserted points are collected to a PointThinner
+                 * until finish_insertion() is called.
+                 */
+                void set_thinning(ThinningPolicy policy, double cell_size);
+
+                /**
+                 * \brief Add the points kept by the thinning to the TIN.
+                 * Must be called after all the points have been inserted.
+                 */
+                void finish_insertion();
+
+                /**
+                 * \brief Collect the inserted points and build the TIN from
+                 * all of them at once in finish_insertion().
+                 */
+                void set_bulk_insertion(bool bulk);
+
+                /**
+                 * \brief Build the TIN of the bulk insertion in n_threads
+                 * threads.
+                 */
+                void set_tin_threads(unsigned int n_threads) { tin_threads_ = n_threads; }
+
+                /**
+                 * \brief Reserve memory for the given number of points to
+                 * be inserted in the bulk insertion.
+                 */
+                void reserve(size_t n);
+
+                /**
+                 * \brief Number of the inserted points that were ignored
+                 * because a point with the same x and y was already in the
+                 * TIN.
+                 */
+                size_t number_of_duplicates() const { return n_duplicates_; }
+
                 template<typename C>
                 void fill_array(
                     const geo::PixelCenterCoordinate & upper_left,
@@ -37,13 +121,156 @@ namespace io {
                     unsigned int row_start,
                     unsigned int row_stop,
                     bool use_prev_hint);
+
+                /**
+                 * \brief Interpolate the rows [row_start, row_stop) of the
+                 * array starting the point location from the face \a hint,
+                 * or from scratch if the hint is a null handle. Return the
+                 * hint for the following rows.
+                 *
+                 * The interpolator is not modified, so several threads can
+                 * fill different rows at the same time once all the points
+                 * have been inserted, each with its own \a kernel. The
+                 * pixels outside of the TIN are not modified and are
+                 * counted by the kernel.
+                 */
+                template<typename C>
+                Face_handle fill_rows(
+                    const geo::PixelCenterCoordinate & upper_left,
+                    double resolution,
+                    C * data_array,
+                    unsigned int nx,
+                    unsigned int row_start,
+                    unsigned int row_stop,
+                    Face_handle hint,
+                    Kernel &kernel) const;
+
+                /**
+                 * \brief Interpolate the array linearly on the triangles of
+                 * the TIN.
+                 *
+                 * The faces are rasterized one at a time: the pixel centers
+                 * inside a face are found row by row and the plane of the
+                 * face is evaluated along each row. The pixels outside of
+                 * the TIN are not modified.
+                 */
+                template<typename C>
+                void fill_array_linear(
+                    const geo::PixelCenterCoordinate & upper_left,
+                    double resolution,
+                    C * data_array,
+                    unsigned int nx,
+                    unsigned int ny) const;
+
+                /**
+                 * \brief Interpolate the array linearly on the given faces
+                 * of the TIN only, see faces_by_band().
+                 */
+                template<typename C>
+                void fill_array_linear(
+                    const geo::PixelCenterCoordinate & upper_left,
+                    double resolution,
+                    C * data_array,
+                    unsigned int nx,
+                    unsigned int ny,
+                    const std::vector<Face_handle> & faces) const;
+
+                /**
+                 * \brief Group the faces of the TIN by the bands of
+                 * band_height rows of an array of ny rows whose first row
+                 * has the pixel centers at upper_left_y. A face is in every
+                 * band that has a pixel center row within its y extent, so
+                 * that the bands can be interpolated linearly one at a
+                 * time without going through all the faces for each.
+                 */
+                std::vector<std::vector<Face_handle>> faces_by_band(
+                    double upper_left_y,
+                    double resolution,
+                    unsigned int band_height,
+                    unsigned int ny) const;
             private:
                 std::unique_ptr<TIN> tin_ptr_;
-                std::map<TIN::Point, Coord_type, TIN::K::Less_xy_2> function_values_;
-                TIN::Delaunay_triangulation::Face_handle fh_hint_;
+                Face_handle fh_hint_;
+                Kernel kernel_;
+                std::unique_ptr<PointThinner> thinner_;
+                size_t n_duplicates_;
+                bool bulk_;
+                unsigned int tin_threads_;
+                std::vector<TIN::Point> pending_points_;
+                std::vector<Coord_type> pending_values_;
+                /// The origin of the coordinates of the TIN.
+                double x_origin_;
+                double y_origin_;
+                bool has_origin_;
+                double value_scale_;
+                double value_offset_;
+
+                void insert_pending_points();
+
+                TIN::Point to_local(double x, double y) const
+                {
+                    return TIN::Point(x - x_origin_, y - y_origin_);
+                }
 
                 double get_value_at(const TIN::Point &p, bool = true) const;
 
+                /**
+                 * \brief Rasterize the finite face f to the array whose
+                 * first pixel center is at (x0, y0) relative to the origin.
+                 */
+                template<typename F, typename C>
+                void fill_face_linear(
+                    const F & f,
+                    double x0,
+                    double y0,
+                    double resolution,
+                    C * data_array,
+                    unsigned int nx,
+                    unsigned int ny) const;
+
+                /**
+                 * \brief The elevation z as a value of the type C. The
+                 * integer values are clamped to the range of the type
+                 * without the lowest value of a signed type or the highest
+                 * one of an unsigned type, which is left for the no-data
+                 * value. The clamped values are counted.
+                 */
+                template<typename C>
+                C to_value(double z) const
+                {
+                    double v {(z - value_offset_) / value_scale_};
+                    if (std::is_integral<C>::value) {
+                        const bool is_signed {std::is_signed<C>::value};
+                        const double low {static_cast<double>(
+                            std::numeric_limits<C>::lowest()) + (is_signed ? 1 : 0)};
+                        const double high {static_cast<double>(
+                            std::numeric_limits<C>::max()) - (is_signed ? 0 : 1)};
+                        v = std::round(v);
+                        if (!(v >= low && v <= high)) {
+                            count_clamped_value();
+                            v = std::min(std::max(v, low), high);
+                        }
+                    }
+                    return static_cast<C>(v);
+                }
+
+                static void count_clamped_value();
+
+                /**
+                 * \brief Interpolate the elevation from the elevations of
+                 * the natural neighbors and their Sibson coordinates.
+                 */
+                static Coord_type interpolate(
+                    const std::vector<Neighbor> &neighbors,
+                    Coord_type norm)
+                {
+                    Coord_type value {0};
+                    for (const auto &n: neighbors) {
+                        value += n.second * n.first->info().z;
+                    }
+                    return value / norm;
+                }
+
         };
 
         template<typename C>
@@ -56,38 +283,155 @@ namespace io {
             unsigned int row_stop,
             bool use_prev_hint)
         {
-            TIN::Delaunay_triangulation::Face_handle fh, fh_row_begin;
-            TIN::Point ul(upper_left.x(), upper_left.y());
-            if (use_prev_hint)
-                fh = fh_hint_;
-            else
-                fh = tin_ptr_->T_.locate(ul);
-            fh_row_begin = fh;
-            using Value_access = CGAL::Data_access<std::map<TIN::Point, Coord_type, TIN::K::Less_xy_2>>;
+            fh_hint_ = fill_rows(upper_left, resolution, data_array, nx,
+                row_start, row_stop,
+                use_prev_hint ? fh_hint_ : Face_handle(), kernel_);
+        }
+
+        template<typename C>
+        Interpolator::Face_handle Interpolator::fill_rows(
+            const geo::PixelCenterCoordinate & upper_left,
+            double resolution,
+            C * data_array,
+            unsigned int nx,
+            unsigned int row_start,
+            unsigned int row_stop,
+            Face_handle hint,
+            Kernel &kernel) const
+        {
+            const TIN::Point ul {to_local(upper_left.x(), upper_left.y())};
+            Face_handle fh {hint}, fh_row_begin {hint};
             for (unsigned int j = row_start; j < row_stop; ++j) {
                 for (unsigned int i = 0; i < nx; ++i) {
-                    std::vector<std::pair<TIN::Point, Coord_type>> coords;
-                    TIN::Point p(upper_left.x() + i * resolution,
-                                 upper_left.y() - j * resolution);
-                    if (i == 0) {
-                        fh_row_begin = tin_ptr_->T_.locate(p, fh_row_begin);
-                        fh = fh_row_begin;
-                    } else {
-                        fh = tin_ptr_->T_.locate(p, fh);
+                    TIN::Point p(ul.x() + i * resolution,
+                                 ul.y() - j * resolution);
+                    bool found {kernel.compute(tin_ptr_->T_, p,
+                        i == 0 ? fh_row_begin : fh)};
+                    fh = kernel.face();
+                    if (i == 0) fh_row_begin = fh;
+                    if (found) {
+                        data_array[j * nx + i] = to_value<C>(
+                            interpolate(kernel.neighbors(), kernel.norm()));
                     }
-                    Coord_type norm = CGAL::natural_neighbor_coordinates_2(
-                        tin_ptr_->T_, p, std::back_inserter(coords), fh).second;
-                    if (coords.size() > 0) {
-                        data_array[j * nx + i] = static_cast<C>(
-                            CGAL::linear_interpolation(
-                                coords.begin(), coords.end(), norm,
-                                Value_access(function_values_)));
+                }
+            }
+            return fh_row_begin;
+        }
+
+        template<typename C>
+        void Interpolator::fill_array_linear(
+            const geo::PixelCenterCoordinate & upper_left,
+            double resolution,
+            C * data_array,
+            unsigned int nx,
+            unsigned int ny) const
+        {
+            const double x0 {upper_left.x() - x_origin_};
+            const double y0 {upper_left.y() - y_origin_};
+            const TIN::Delaunay_triangulation &T {tin_ptr_->T_};
+            for (auto f = T.finite_faces_begin(); f != T.finite_faces_end(); ++f) {
+                fill_face_linear(f, x0, y0, resolution, data_array, nx, ny);
+            }
+        }
+
+        template<typename C>
+        void Interpolator::fill_array_linear(
+            const geo::PixelCenterCoordinate & upper_left,
+            double resolution,
+            C * data_array,
+            unsigned int nx,
+            unsigned int ny,
+            const std::vector<Face_handle> & faces) const
+        {
+            const double x0 {upper_left.x() - x_origin_};
+            const double y0 {upper_left.y() - y_origin_};
+            for (const auto &f: faces) {
+                fill_face_linear(f, x0, y0, resolution, data_array, nx, ny);
+            }
+        }
+
+        template<typename F, typename C>
+        void Interpolator::fill_face_linear(
+            const F & f,
+            double x0,
+            double y0,
+            double resolution,
+            C * data_array,
+            unsigned int nx,
+            unsigned int ny) const
+        {
+            TIN::Point v[3] {
+                f->vertex(0)->point(),
+                f->vertex(1)->point(),
+                f->vertex(2)->point()};
+            double z[3] {
+                f->vertex(0)->info().z,
+                f->vertex(1)->info().z,
+                f->vertex(2)->info().z};
+
+            // The plane z = z[0] + a * (x - v0.x) + b * (y - v0.y).
+            double ux {v[1].x() - v[0].x()}, uy {v[1].y() - v[0].y()};
+            double wx {v[2].x() - v[0].x()}, wy {v[2].y() - v[0].y()};
+            double det {ux * wy - uy * wx};
+            if (det == 0) return;
+            double a {((z[1] - z[0]) * wy - (z[2] - z[0]) * uy) / det};
+            double b {((z[2] - z[0]) * ux - (z[1] - z[0]) * wx) / det};
+
+            // The edges with the end points in the same order in both
+            // of the faces sharing them, so that the neighbouring faces
+            // compute exactly the same crossings and no pixel center
+            // on a shared edge is missed.
+            TIN::Point e[3][2];
+            for (int k = 0; k < 3; ++k) {
+                const TIN::Point &p {v[k]};
+                const TIN::Point &q {v[(k + 1) % 3]};
+                bool p_first {p.y() < q.y() ||
+                    (p.y() == q.y() && p.x() < q.x())};
+                e[k][0] = p_first ? p : q;
+                e[k][1] = p_first ? q : p;
+            }
+
+            double min_y {std::min({v[0].y(), v[1].y(), v[2].y()})};
+            double max_y {std::max({v[0].y(), v[1].y(), v[2].y()})};
+            double j_first {std::max(0.0, std::ceil((y0 - max_y) / resolution))};
+            double j_last {std::min(static_cast<double>(ny) - 1,
+                std::floor((y0 - min_y) / resolution))};
+            for (double jd = j_first; jd <= j_last; ++jd) {
+                unsigned int j {static_cast<unsigned int>(jd)};
+                double y {y0 - j * resolution};
+                double left {std::numeric_limits<double>::max()};
+                double right {std::numeric_limits<double>::lowest()};
+                for (int k = 0; k < 3; ++k) {
+                    const TIN::Point &p {e[k][0]};
+                    const TIN::Point &q {e[k][1]};
+                    if (y < p.y() || y > q.y()) continue;
+                    if (p.y() == q.y()) {
+                        left = std::min(left, p.x());
+                        right = std::max(right, q.x());
                     } else {
-                        std::cout << "No data for cell (" << j << "," << i << ")" << std::endl;
+                        double x {p.x() + (y - p.y()) *
+                            (q.x() - p.x()) / (q.y() - p.y())};
+                        left = std::min(left, x);
+                        right = std::max(right, x);
                     }
                 }
+                if (left > right) continue;
+                double i_first {std::max(0.0, std::ceil((left - x0) / resolution))};
+                double i_last {std::min(static_cast<double>(nx) - 1,
+                    std::floor((right - x0) / resolution))};
+                if (i_first > i_last) continue;
+
+                // The plane is evaluated independently at each pixel of
+                // the row, which the compiler can vectorize.
+                unsigned int i0 {static_cast<unsigned int>(i_first)};
+                unsigned int i1 {static_cast<unsigned int>(i_last) + 1};
+                double base {z[0] + a * (x0 - v[0].x()) + b * (y - v[0].y())};
+                double step {a * resolution};
+                C *row {data_array + static_cast<size_t>(j) * nx};
+                for (unsigned int i = i0; i < i1; ++i) {
+                    row[i] = to_value<C>(base + i * step);
+                }
             }
-            fh_hint_ = fh_row_begin;
         }
 
     }
@@ -0,0 +1,155 @@
+#include "MappedLasFile.h"
+
+#include <sstream>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+    template<typename T>
+    T read_at(const char *data, size_t offset)
+    {
+        T value;
+        std::memcpy(&value, data + offset, sizeof(T));
+        return value;
+    }
+
+    // Offsets of the fields of the LAS public header block.
+    const size_t version_minor_offset {25};
+    const size_t header_size_offset {94};
+    const size_t point_data_offset {96};
+    const size_t point_format_offset {104};
+    const size_t record_length_offset {105};
+    const size_t legacy_n_points_offset {107};
+    const size_t scale_offset {131};
+    const size_t offset_offset {155};
+    const size_t bounds_offset {179};
+    const size_t n_points_14_offset {247};
+    const size_t header_size_14 {375};
+    const size_t header_size_min {227};
+
+}
+
+namespace io {
+
+    namespace point_cloud {
+
+        MappedLasFile::MappedLasFile(const std::string &filename):
+            fd_ {-1}, data_ {nullptr}, size_ {0}, points_ {nullptr},
+            n_points_ {0}, point_format_ {0}, record_length_ {0},
+            class_offset_ {0}, class_bits_ {0},
+            min_x_ {0}, max_x_ {0}, min_y_ {0}, max_y_ {0}
+        {
+            fd_ = open(filename.c_str(), O_RDONLY);
+            if (fd_ < 0) {
+                std::stringstream ss;
+                ss << "Failed to open the file '" << filename << "'.";
+                throw std::runtime_error(ss.str());
+            }
+            struct stat st;
+            if (fstat(fd_, &st) != 0 ||
+                static_cast<size_t>(st.st_size) < header_size_min) {
+                close(fd_);
+                std::stringstream ss;
+                ss << "The file '" << filename << "' is not a LAS file.";
+                throw std::runtime_error(ss.str());
+            }
+            size_ = static_cast<size_t>(st.st_size);
+            void *p {mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd_, 0)};
+            if (p == MAP_FAILED) {
+                close(fd_);
+                std::stringstream ss;
+                ss << "Failed to map the file '" << filename << "'.";
+                throw std::runtime_error(ss.str());
+            }
+            data_ = static_cast<char*>(p);
+            // The points are read once from the beginning to the end.
+            madvise(data_, size_, MADV_SEQUENTIAL);
+            try {
+                parse_header(filename);
+            } catch (...) {
+                munmap(data_, size_);
+                close(fd_);
+                throw;
+            }
+        }
+
+        MappedLasFile::~MappedLasFile()
+        {
+            if (data_) {
+                munmap(data_, size_);
+                data_ = nullptr;
+            }
+            if (fd_ >= 0) {
+                close(fd_);
+                fd_ = -1;
+            }
+        }
+
+        void MappedLasFile::parse_header(const std::string &filename)
+        {
+            if (std::memcmp(data_, "LASF", 4) != 0) {
+                std::stringstream ss;
+                ss << "The file '" << filename << "' is not a LAS file.";
+                throw std::runtime_error(ss.str());
+            }
+            auto version_minor = read_at<std::uint8_t>(data_, version_minor_offset);
+            auto header_size = read_at<std::uint16_t>(data_, header_size_offset);
+            auto offset = read_at<std::uint32_t>(data_, point_data_offset);
+            auto format = read_at<std::uint8_t>(data_, point_format_offset);
+            if (format & 0xc0) {
+                std::stringstream ss;
+                ss << "The file '" << filename << "' is compressed.";
+                throw std::runtime_error(ss.str());
+            }
+            point_format_ = format;
+            record_length_ = read_at<std::uint16_t>(data_, record_length_offset);
+            n_points_ = read_at<std::uint32_t>(data_, legacy_n_points_offset);
+            if (version_minor >= 4 && header_size >= header_size_14) {
+                auto n = read_at<std::uint64_t>(data_, n_points_14_offset);
+                if (n > 0) n_points_ = n;
+            }
+
+            quantization_.x_scale = read_at<double>(data_, scale_offset);
+            quantization_.y_scale = read_at<double>(data_, scale_offset + 8);
+            quantization_.z_scale = read_at<double>(data_, scale_offset + 16);
+            quantization_.x_offset = read_at<double>(data_, offset_offset);
+            quantization_.y_offset = read_at<double>(data_, offset_offset + 8);
+            quantization_.z_offset = read_at<double>(data_, offset_offset + 16);
+            max_x_ = read_at<double>(data_, bounds_offset);
+            min_x_ = read_at<double>(data_, bounds_offset + 8);
+            max_y_ = read_at<double>(data_, bounds_offset + 16);
+            min_y_ = read_at<double>(data_, bounds_offset + 24);
+
+            // Formats 6-10 store the full class in its own byte, the older
+            // ones share the byte with the synthetic, keypoint and withheld
+            // flags.
+            if (point_format_ >= 6) {
+                class_offset_ = 16;
+                class_bits_ = 0xff;
+            } else {
+                class_offset_ = 15;
+                class_bits_ = 0x1f;
+            }
+            if (record_length_ < class_offset_ + 1) {
+                std::stringstream ss;
+                ss << "Invalid point record length in the file '"
+                    << filename << "'.";
+                throw std::runtime_error(ss.str());
+            }
+            if (offset > size_ ||
+                n_points_ > (size_ - offset) / record_length_) {
+                std::stringstream ss;
+                ss << "The file '" << filename << "' is truncated.";
+                throw std::runtime_error(ss.str());
+            }
+            points_ = data_ + offset;
+        }
+
+    }
+
+}
@@ -0,0 +1,89 @@
+#ifndef MAPPED_LAS_FILE_H_
+#define MAPPED_LAS_FILE_H_
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+#include "PointBlock.h"
+
+namespace io {
+
+    namespace point_cloud {
+
+        /**
+         * \brief Read-only memory mapping of an uncompressed .las file.
+         *
+         * The header is parsed from the mapping and the point records are
+         * accessed in place without copying them.
+         */
+        class MappedLasFile
+        {
+            public:
+                explicit MappedLasFile(const std::string &filename);
+                ~MappedLasFile();
+                MappedLasFile(const MappedLasFile &) = delete;
+                MappedLasFile & operator=(const MappedLasFile &) = delete;
+
+                std::uint64_t number_of_points() const { return n_points_; }
+                unsigned int point_format() const { return point_format_; }
+                size_t record_length() const { return record_length_; }
+                const Quantization & quantization() const { return quantization_; }
+
+                double min_x() const { return min_x_; }
+                double max_x() const { return max_x_; }
+                double min_y() const { return min_y_; }
+                double max_y() const { return max_y_; }
+
+                /**
+                 * \brief Return the pointer to the beginning of the i'th
+                 * point record.
+                 */
+                const char * record(std::uint64_t i) const
+                {
+                    return points_ + i * record_length_;
+                }
+
+                /**
+                 * \brief Offset of the classification byte in the records.
+                 */
+                size_t class_offset() const { return class_offset_; }
+
+                /**
+                 * \brief The bits of the classification byte that hold the
+                 * class.
+                 */
+                std::uint8_t class_bits() const { return class_bits_; }
+
+                static std::int32_t X(const char *rec) { return read_int32(rec); }
+                static std::int32_t Y(const char *rec) { return read_int32(rec + 4); }
+                static std::int32_t Z(const char *rec) { return read_int32(rec + 8); }
+
+            private:
+                int fd_;
+                char *data_;
+                size_t size_;
+                const char *points_;
+                std::uint64_t n_points_;
+                unsigned int point_format_;
+                size_t record_length_;
+                size_t class_offset_;
+                std::uint8_t class_bits_;
+                Quantization quantization_;
+                double min_x_, max_x_, min_y_, max_y_;
+
+                void parse_header(const std::string &filename);
+
+                static std::int32_t read_int32(const char *p)
+                {
+                    std::int32_t v;
+                    std::memcpy(&v, p, sizeof(v));
+                    return v;
+                }
+        };
+
+    }
+
+}
+
+#endif
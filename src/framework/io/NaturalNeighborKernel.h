@@ -0,0 +1,247 @@
+#ifndef NATURAL_NEIGHBOR_KERNEL_H_
+#define NATURAL_NEIGHBOR_KERNEL_H_
+
+#include <cmath>
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+#include <CGAL/enum.h>
+
+namespace io {
+
+    namespace point_cloud {
+
+        /**
+         * \brief Sibson's natural neighbor coordinates computed from the
+         * conflict zone of the query point in a Delaunay triangulation.
+         *
+         * The conflict zone, its boundary and the coordinates are kept in
+         * vectors that are reused from one query to the next, so after
+         * the first few queries no memory is allocated. One kernel must
+         * not be used by several threads at the same time, but any number
+         * of kernels can query the same triangulation.
+         */
+        template<typename Dt>
+        class NaturalNeighborKernel
+        {
+            public:
+                using Face_handle = typename Dt::Face_handle;
+                using Vertex_handle = typename Dt::Vertex_handle;
+                using Point = typename Dt::Point;
+                using Neighbor = std::pair<Vertex_handle, double>;
+
+                NaturalNeighborKernel(): norm_ {0}, n_outside_ {0}
+                {
+                }
+
+                /**
+                 * \brief Compute the coordinates of the point \a p
+                 * starting the point location from the face \a hint.
+                 * Return false if the point is outside of the convex hull
+                 * of the triangulation.
+                 */
+                bool compute(const Dt &dt, const Point &p, Face_handle hint);
+
+                /// The natural neighbors and their coordinates.
+                const std::vector<Neighbor> & neighbors() const { return neighbors_; }
+                /// The sum of the coordinates.
+                double norm() const { return norm_; }
+                /// The face containing the last query point.
+                Face_handle face() const { return face_; }
+                /// The number of the query points outside of the convex
+                /// hull so far.
+                size_t number_outside() const { return n_outside_; }
+
+            private:
+                /// An edge of the boundary of the conflict zone, from a to
+                /// b counterclockwise around the query point.
+                struct BoundaryEdge
+                {
+                    Face_handle face;
+                    Vertex_handle a;
+                    Vertex_handle b;
+                };
+
+                std::vector<Face_handle> conflicts_;
+                std::vector<Face_handle> stack_;
+                std::vector<BoundaryEdge> boundary_;
+                std::vector<Neighbor> neighbors_;
+                double norm_;
+                Face_handle face_;
+                size_t n_outside_;
+
+                bool in_conflicts(Face_handle f) const
+                {
+                    for (const auto &c: conflicts_) {
+                        if (c == f) return true;
+                    }
+                    return false;
+                }
+
+                void find_conflicts(const Dt &dt, const Point &p);
+                void order_boundary();
+
+                /**
+                 * \brief The circumcenter of the triangle relative to the
+                 * query point at the origin.
+                 */
+                static void circumcenter(
+                    double ax, double ay, double bx, double by,
+                    double cx, double cy, double &x, double &y);
+        };
+
+        template<typename Dt>
+        bool NaturalNeighborKernel<Dt>::compute(
+            const Dt &dt,
+            const Point &p,
+            Face_handle hint)
+        {
+            neighbors_.clear();
+            norm_ = 0;
+            face_ = hint;
+            if (dt.dimension() < 2) {
+                ++n_outside_;
+                return false;
+            }
+            typename Dt::Locate_type lt;
+            int li;
+            face_ = dt.locate(p, lt, li, hint);
+            if (lt == Dt::OUTSIDE_CONVEX_HULL || lt == Dt::OUTSIDE_AFFINE_HULL) {
+                ++n_outside_;
+                return false;
+            }
+            if (lt == Dt::VERTEX) {
+                neighbors_.push_back({face_->vertex(li), 1.0});
+                norm_ = 1.0;
+                return true;
+            }
+            if (lt == Dt::EDGE && (dt.is_infinite(face_) ||
+                                   dt.is_infinite(face_->neighbor(li)))) {
+                // On the convex hull the coordinates are the barycentric
+                // coordinates on the hull edge.
+                Vertex_handle a {face_->vertex(Dt::ccw(li))};
+                Vertex_handle b {face_->vertex(Dt::cw(li))};
+                double la {std::hypot(p.x() - b->point().x(), p.y() - b->point().y())};
+                double lb {std::hypot(p.x() - a->point().x(), p.y() - a->point().y())};
+                neighbors_.push_back({a, la});
+                neighbors_.push_back({b, lb});
+                norm_ = la + lb;
+                return true;
+            }
+
+            find_conflicts(dt, p);
+            order_boundary();
+
+            // The area that the new cell of p takes from the cell of each
+            // boundary vertex v is bounded by the circumcenters of the new
+            // triangles on both sides of v and by the circumcenters of the
+            // conflicting faces around v.
+            const double px {p.x()}, py {p.y()};
+            const size_t m {boundary_.size()};
+            for (size_t k = 0; k < m; ++k) {
+                const BoundaryEdge &prev {boundary_[(k + m - 1) % m]};
+                const BoundaryEdge &next {boundary_[k]};
+                Vertex_handle v {next.a};
+
+                double x0, y0, x1, y1;
+                circumcenter(
+                    prev.a->point().x() - px, prev.a->point().y() - py,
+                    v->point().x() - px, v->point().y() - py,
+                    0, 0, x0, y0);
+                double first_x {x0}, first_y {y0};
+                double area2 {0};
+                Face_handle f {prev.face};
+                for (;;) {
+                    circumcenter(
+                        f->vertex(0)->point().x() - px, f->vertex(0)->point().y() - py,
+                        f->vertex(1)->point().x() - px, f->vertex(1)->point().y() - py,
+                        f->vertex(2)->point().x() - px, f->vertex(2)->point().y() - py,
+                        x1, y1);
+                    area2 += x0 * y1 - x1 * y0;
+                    x0 = x1;
+                    y0 = y1;
+                    if (f == next.face) break;
+                    // Turn clockwise around v towards the next boundary
+                    // edge; the faces in between are all in conflict.
+                    f = f->neighbor(Dt::cw(f->index(v)));
+                }
+                circumcenter(
+                    v->point().x() - px, v->point().y() - py,
+                    next.b->point().x() - px, next.b->point().y() - py,
+                    0, 0, x1, y1);
+                area2 += x0 * y1 - x1 * y0;
+                area2 += x1 * first_y - first_x * y1;
+                double area {std::fabs(area2) / 2};
+                neighbors_.push_back({v, area});
+                norm_ += area;
+            }
+            return norm_ > 0;
+        }
+
+        template<typename Dt>
+        void NaturalNeighborKernel<Dt>::find_conflicts(
+            const Dt &dt,
+            const Point &p)
+        {
+            conflicts_.clear();
+            boundary_.clear();
+            stack_.clear();
+            // The face containing p is always in conflict.
+            conflicts_.push_back(face_);
+            stack_.push_back(face_);
+            while (!stack_.empty()) {
+                Face_handle f {stack_.back()};
+                stack_.pop_back();
+                for (int i = 0; i < 3; ++i) {
+                    Face_handle n {f->neighbor(i)};
+                    if (in_conflicts(n)) continue;
+                    // Inside the convex hull p is never in conflict with
+                    // the infinite faces.
+                    if (!dt.is_infinite(n) &&
+                        dt.side_of_oriented_circle(n, p) == CGAL::ON_POSITIVE_SIDE) {
+                        conflicts_.push_back(n);
+                        stack_.push_back(n);
+                    } else {
+                        boundary_.push_back(
+                            {f, f->vertex(Dt::ccw(i)), f->vertex(Dt::cw(i))});
+                    }
+                }
+            }
+        }
+
+        template<typename Dt>
+        void NaturalNeighborKernel<Dt>::order_boundary()
+        {
+            // Chain the edges so that each one starts where the previous
+            // one ends. The boundary is short, so a quadratic search is
+            // faster than anything fancier.
+            const size_t m {boundary_.size()};
+            for (size_t k = 1; k < m; ++k) {
+                for (size_t l = k; l < m; ++l) {
+                    if (boundary_[l].a == boundary_[k - 1].b) {
+                        std::swap(boundary_[k], boundary_[l]);
+                        break;
+                    }
+                }
+            }
+        }
+
+        template<typename Dt>
+        void NaturalNeighborKernel<Dt>::circumcenter(
+            double ax, double ay, double bx, double by,
+            double cx, double cy, double &x, double &y)
+        {
+            double d {2 * (ax * (by - cy) + bx * (cy - ay) + cx * (ay - by))};
+            double a2 {ax * ax + ay * ay};
+            double b2 {bx * bx + by * by};
+            double c2 {cx * cx + cy * cy};
+            x = (a2 * (by - cy) + b2 * (cy - ay) + c2 * (ay - by)) / d;
+            y = (a2 * (cx - bx) + b2 * (ax - cx) + c2 * (bx - ax)) / d;
+        }
+
+    }
+
+}
+
+#endif
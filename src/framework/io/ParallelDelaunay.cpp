@@ -0,0 +1,479 @@
+#include "ParallelDelaunay.h"
+
+#ifndef COMPACT_TIN
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <exception>
+#include <iostream>
+#include <limits>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+
+namespace {
+
+    using K = io::point_cloud::TIN::K;
+    using Point = io::point_cloud::TIN::Point;
+    using Dt = io::point_cloud::TIN::Delaunay_triangulation;
+    using Points = std::vector<std::pair<Point, io::point_cloud::TIN::VertexInfo>>;
+
+    /// A triangulation of a part of the points with the index of each
+    /// point in its vertex.
+    using PartVb = CGAL::Triangulation_vertex_base_with_info_2<std::uint32_t, K>;
+    using PartTds = CGAL::Triangulation_data_structure_2<PartVb>;
+    using PartDt = CGAL::Delaunay_triangulation_2<K, PartTds>;
+
+    /// Below this the threads cost more than they save.
+    const size_t min_points_per_strip {1 << 16};
+
+    /// The indices of the vertices of a triangle, counterclockwise.
+    struct Triangle
+    {
+        std::uint32_t v[3];
+    };
+
+    /// The points [begin, end) with lo <= x < hi.
+    struct Strip
+    {
+        size_t begin;
+        size_t end;
+        double lo;
+        double hi;
+    };
+
+    struct Circle
+    {
+        double x;
+        double y;
+        double r;
+        /// A bound of the rounding errors of the center and the radius.
+        double margin;
+    };
+
+    /// A triangle edge leaving a vertex.
+    struct HalfEdge
+    {
+        std::uint32_t to;
+        std::uint32_t face;
+        /// The index of the vertex of the face opposite to the edge.
+        std::uint8_t opposite;
+    };
+
+    /**
+     * \brief Call f(i) for each i in [0, n) in n_threads threads.
+     */
+    template<typename F>
+    void for_each_parallel(size_t n, unsigned int n_threads, F f)
+    {
+        std::mutex m;
+        size_t next {0};
+        std::exception_ptr error;
+        auto worker = [&]() {
+            for (;;) {
+                size_t i;
+                {
+                    std::lock_guard<std::mutex> lock {m};
+                    if (next >= n || error) return;
+                    i = next++;
+                }
+                try {
+                    f(i);
+                } catch (...) {
+                    std::lock_guard<std::mutex> lock {m};
+                    if (!error) error = std::current_exception();
+                }
+            }
+        };
+        std::vector<std::thread> threads;
+        for (size_t t = 0; t < std::min<size_t>(n_threads, n); ++t) {
+            threads.emplace_back(worker);
+        }
+        for (auto &t: threads) t.join();
+        if (error) std::rethrow_exception(error);
+    }
+
+    /**
+     * \brief The circumcircle of the triangle. The vertices are taken in
+     * the lexicographic order, so the same triangle found in two
+     * triangulations gives exactly the same circle.
+     */
+    Circle circumcircle(Point a, Point b, Point c)
+    {
+        auto less = [](const Point &p, const Point &q) {
+            return p.x() < q.x() || (p.x() == q.x() && p.y() < q.y());
+        };
+        if (less(b, a)) std::swap(a, b);
+        if (less(c, b)) std::swap(b, c);
+        if (less(b, a)) std::swap(a, b);
+
+        const double eps {std::numeric_limits<double>::epsilon()};
+        double bx {b.x() - a.x()}, by {b.y() - a.y()};
+        double cx {c.x() - a.x()}, cy {c.y() - a.y()};
+        double b2 {bx * bx + by * by};
+        double c2 {cx * cx + cy * cy};
+        double d {2 * (bx * cy - by * cx)};
+        double ux {(cy * b2 - by * c2) / d};
+        double uy {(bx * c2 - cx * b2) / d};
+        double r {std::hypot(ux, uy)};
+        double err_d {16 * eps * (std::fabs(bx * cy) + std::fabs(by * cx))};
+        double err_x {(8 * eps * (std::fabs(cy) * b2 + std::fabs(by) * c2)
+            + std::fabs(ux) * err_d) / std::fabs(d)};
+        double err_y {(8 * eps * (std::fabs(bx) * c2 + std::fabs(cx) * b2)
+            + std::fabs(uy) * err_d) / std::fabs(d)};
+        double margin {2 * (err_x + err_y)
+            + 16 * eps * (std::fabs(a.x()) + std::fabs(a.y()) + r)};
+        return {a.x() + ux, a.y() + uy, r, margin};
+    }
+
+    /**
+     * \brief Whether the closed disk of the circle is certainly within
+     * the strip. Then no point of the other strips can be inside it.
+     */
+    bool is_within(const Circle &c, const Strip &s)
+    {
+        return c.x - c.r - c.margin > s.lo && c.x + c.r + c.margin < s.hi;
+    }
+
+    /**
+     * \brief Split the sorted points into about n strips of the same size.
+     * The points with the same x are always in the same strip.
+     */
+    std::vector<Strip> make_strips(const Points &points, size_t n)
+    {
+        std::vector<Strip> strips;
+        size_t begin {0};
+        for (size_t i = 0; i < n && begin < points.size(); ++i) {
+            size_t end {i + 1 == n ? points.size() : points.size() * (i + 1) / n};
+            if (end <= begin) continue;
+            while (end < points.size() &&
+                   points[end].first.x() == points[end - 1].first.x()) ++end;
+            strips.push_back({begin, end, 0, 0});
+            begin = end;
+        }
+        for (size_t s = 0; s < strips.size(); ++s) {
+            strips[s].lo = s == 0 ? -std::numeric_limits<double>::infinity()
+                : points[strips[s].begin].first.x();
+            strips[s].hi = s + 1 == strips.size()
+                ? std::numeric_limits<double>::infinity()
+                : points[strips[s + 1].begin].first.x();
+        }
+        return strips;
+    }
+
+    size_t strip_of(const std::vector<Strip> &strips, std::uint32_t i)
+    {
+        auto it = std::upper_bound(strips.begin(), strips.end(), i,
+            [](std::uint32_t i, const Strip &s) { return i < s.begin; });
+        return static_cast<size_t>(it - strips.begin()) - 1;
+    }
+
+    /**
+     * \brief Triangulate the points of the strip. Keep the triangles whose
+     * circumcircle is within the strip and mark the vertices of the other
+     * triangles and of the convex hull of the strip as boundary vertices.
+     */
+    void triangulate_strip(
+        const Points &points,
+        const Strip &strip,
+        PartDt &dt,
+        std::vector<Triangle> &certified,
+        std::vector<char> &on_boundary)
+    {
+        std::vector<std::pair<Point, std::uint32_t>> part;
+        part.reserve(strip.end - strip.begin);
+        for (size_t i = strip.begin; i < strip.end; ++i) {
+            part.push_back({points[i].first, static_cast<std::uint32_t>(i)});
+        }
+        dt.insert(part.begin(), part.end());
+        std::vector<std::pair<Point, std::uint32_t>>().swap(part);
+        if (dt.dimension() < 2) {
+            for (size_t i = strip.begin; i < strip.end; ++i) on_boundary[i] = 1;
+            return;
+        }
+        for (auto f = dt.finite_faces_begin(); f != dt.finite_faces_end(); ++f) {
+            Triangle t {{f->vertex(0)->info(), f->vertex(1)->info(),
+                f->vertex(2)->info()}};
+            Circle c {circumcircle(f->vertex(0)->point(),
+                f->vertex(1)->point(), f->vertex(2)->point())};
+            if (is_within(c, strip)) {
+                certified.push_back(t);
+            } else {
+                for (int i = 0; i < 3; ++i) on_boundary[t.v[i]] = 1;
+            }
+            for (int i = 0; i < 3; ++i) {
+                if (dt.is_infinite(f->neighbor(i))) {
+                    on_boundary[t.v[PartDt::ccw(i)]] = 1;
+                    on_boundary[t.v[PartDt::cw(i)]] = 1;
+                }
+            }
+        }
+    }
+
+    /**
+     * \brief Whether no point of any strip is strictly inside the
+     * circumcircle c of the counterclockwise triangle abc.
+     */
+    bool is_empty(
+        const Circle &c,
+        const Point &a, const Point &b, const Point &p,
+        const std::vector<Strip> &strips,
+        const std::vector<PartDt> &parts)
+    {
+        if (!std::isfinite(c.x) || !std::isfinite(c.y) || !std::isfinite(c.r)) {
+            return false;
+        }
+        auto side = K().side_of_oriented_circle_2_object();
+        Point center {c.x, c.y};
+        for (size_t s = 0; s < strips.size(); ++s) {
+            if (strips[s].hi < c.x - c.r - c.margin ||
+                strips[s].lo > c.x + c.r + c.margin) continue;
+            PartDt::Vertex_handle v {parts[s].nearest_vertex(center)};
+            if (side(a, b, p, v->point()) == CGAL::ON_POSITIVE_SIDE) return false;
+        }
+        return true;
+    }
+
+    /**
+     * \brief Link the triangles into the triangulation T. Return false if
+     * they do not form a Delaunay triangulation of all the points.
+     */
+    bool link_triangles(
+        Dt &T,
+        const Points &points,
+        const std::vector<Triangle> &faces,
+        unsigned int n_threads)
+    {
+        const size_t n {points.size()};
+        const size_t m {faces.size()};
+
+        // The half-edges leaving each vertex sorted by their end vertex.
+        std::vector<size_t> first(n + 1, 0);
+        for (const auto &t: faces) {
+            for (int i = 0; i < 3; ++i) ++first[t.v[i] + 1];
+        }
+        for (size_t v = 0; v < n; ++v) first[v + 1] += first[v];
+        std::vector<HalfEdge> half_edges(3 * m);
+        {
+            std::vector<size_t> pos(first.begin(), first.end() - 1);
+            for (size_t f = 0; f < m; ++f) {
+                const Triangle &t {faces[f]};
+                for (int i = 0; i < 3; ++i) {
+                    half_edges[pos[t.v[i]]++] = {t.v[(i + 1) % 3],
+                        static_cast<std::uint32_t>(f),
+                        static_cast<std::uint8_t>((i + 2) % 3)};
+                }
+            }
+        }
+        for (size_t v = 0; v < n; ++v) {
+            if (first[v] == first[v + 1]) return false;
+            auto b = half_edges.begin() + first[v];
+            auto e = half_edges.begin() + first[v + 1];
+            std::sort(b, e, [](const HalfEdge &x, const HalfEdge &y) {
+                return x.to < y.to;
+            });
+            if (std::adjacent_find(b, e, [](const HalfEdge &x, const HalfEdge &y) {
+                    return x.to == y.to;
+                }) != e) return false;
+        }
+        auto twin = [&](std::uint32_t from, std::uint32_t to) -> const HalfEdge * {
+            auto b = half_edges.begin() + first[to];
+            auto e = half_edges.begin() + first[to + 1];
+            auto it = std::lower_bound(b, e, from,
+                [](const HalfEdge &x, std::uint32_t v) { return x.to < v; });
+            if (it == e || it->to != from) return nullptr;
+            return &*it;
+        };
+
+        // The convex hull is the single cycle of the edges without a twin,
+        // turning left or going straight at each vertex.
+        std::unordered_map<std::uint32_t, const HalfEdge *> hull;
+        for (size_t v = 0; v < n; ++v) {
+            for (size_t e = first[v]; e < first[v + 1]; ++e) {
+                if (twin(static_cast<std::uint32_t>(v), half_edges[e].to)) continue;
+                if (!hull.insert({static_cast<std::uint32_t>(v), &half_edges[e]}).second) {
+                    return false;
+                }
+            }
+        }
+        const size_t h {hull.size()};
+        if (h < 3 || m + 2 + h != 2 * n) return false;
+        auto orientation = K().orientation_2_object();
+        {
+            std::uint32_t start {hull.begin()->first};
+            std::uint32_t v {start};
+            for (size_t k = 0; k < h; ++k) {
+                if (k > 0 && v == start) return false;
+                std::uint32_t next {hull.at(v)->to};
+                auto it = hull.find(next);
+                if (it == hull.end()) return false;
+                if (orientation(points[v].first, points[next].first,
+                        points[it->second->to].first) == CGAL::CLOCKWISE) {
+                    return false;
+                }
+                v = next;
+            }
+            if (v != start) return false;
+        }
+
+        // A triangulation of the convex hull where each edge is locally
+        // Delaunay is the Delaunay triangulation.
+        const size_t block {1 << 16};
+        std::vector<char> delaunay((n + block - 1) / block, 1);
+        auto side = K().side_of_oriented_circle_2_object();
+        for_each_parallel(delaunay.size(), n_threads, [&](size_t b) {
+            for (size_t v = b * block; v < std::min(n, (b + 1) * block); ++v) {
+                for (size_t e = first[v]; e < first[v + 1]; ++e) {
+                    const HalfEdge &he {half_edges[e]};
+                    if (he.to < v) continue;
+                    const HalfEdge *tw {twin(static_cast<std::uint32_t>(v), he.to)};
+                    if (!tw) continue;
+                    const Triangle &t {faces[he.face]};
+                    if (side(points[t.v[0]].first, points[t.v[1]].first,
+                            points[t.v[2]].first,
+                            points[faces[tw->face].v[tw->opposite]].first) ==
+                        CGAL::ON_POSITIVE_SIDE) {
+                        delaunay[b] = 0;
+                        return;
+                    }
+                }
+            }
+        });
+        if (std::find(delaunay.begin(), delaunay.end(), 0) != delaunay.end()) {
+            return false;
+        }
+
+        T.clear();
+        auto &tds = T.tds();
+        std::vector<Dt::Vertex_handle> vh(n);
+        for (size_t v = 0; v < n; ++v) {
+            vh[v] = tds.create_vertex();
+            vh[v]->set_point(points[v].first);
+            vh[v]->info() = points[v].second;
+        }
+        std::vector<Dt::Face_handle> fh(m);
+        for (size_t f = 0; f < m; ++f) {
+            fh[f] = tds.create_face(vh[faces[f].v[0]], vh[faces[f].v[1]],
+                vh[faces[f].v[2]]);
+        }
+        for (size_t v = 0; v < n; ++v) {
+            vh[v]->set_face(fh[half_edges[first[v]].face]);
+            for (size_t e = first[v]; e < first[v + 1]; ++e) {
+                const HalfEdge &he {half_edges[e]};
+                const HalfEdge *tw {twin(static_cast<std::uint32_t>(v), he.to)};
+                if (tw) fh[he.face]->set_neighbor(he.opposite, fh[tw->face]);
+            }
+        }
+        // An infinite face (b, a, infinite) on each hull edge from a to b,
+        // linked to the finite face of the edge and to the infinite faces
+        // of the neighboring hull edges.
+        Dt::Vertex_handle inf {T.infinite_vertex()};
+        std::unordered_map<std::uint32_t, Dt::Face_handle> hull_faces;
+        for (const auto &e: hull) {
+            Dt::Face_handle g {tds.create_face(vh[e.second->to], vh[e.first], inf)};
+            Dt::Face_handle f {fh[e.second->face]};
+            g->set_neighbor(2, f);
+            f->set_neighbor(e.second->opposite, g);
+            hull_faces[e.first] = g;
+        }
+        for (const auto &e: hull) {
+            Dt::Face_handle g {hull_faces.at(e.first)};
+            Dt::Face_handle next {hull_faces.at(e.second->to)};
+            g->set_neighbor(1, next);
+            next->set_neighbor(0, g);
+        }
+        inf->set_face(hull_faces.begin()->second);
+        tds.set_dimension(2);
+        return true;
+    }
+
+}
+
+namespace io {
+
+    namespace point_cloud {
+
+        bool build_delaunay_parallel(
+            TIN::Delaunay_triangulation &T,
+            const std::vector<std::pair<TIN::Point, TIN::VertexInfo>> &points,
+            unsigned int n_threads)
+        {
+            const size_t n {points.size()};
+            if (n > static_cast<size_t>(std::numeric_limits<std::int32_t>::max())) {
+                return false;
+            }
+            if (std::min<size_t>(n_threads, n / min_points_per_strip) < 2) {
+                return false;
+            }
+            std::vector<Strip> strips {make_strips(points,
+                std::min<size_t>(n_threads, n / min_points_per_strip))};
+            if (strips.size() < 2) return false;
+
+            std::vector<PartDt> parts(strips.size());
+            std::vector<std::vector<Triangle>> certified(strips.size());
+            std::vector<char> on_boundary(n, 0);
+            for_each_parallel(strips.size(), n_threads, [&](size_t s) {
+                triangulate_strip(points, strips[s], parts[s], certified[s],
+                    on_boundary);
+            });
+
+            std::vector<Triangle> faces;
+            {
+                size_t n_faces {0};
+                for (const auto &c: certified) n_faces += c.size();
+                faces.reserve(n_faces);
+                for (auto &c: certified) {
+                    faces.insert(faces.end(), c.begin(), c.end());
+                    std::vector<Triangle>().swap(c);
+                }
+            }
+
+            // The triangles of the whole triangulation that were not
+            // certified in any strip have all their vertices on the
+            // boundaries, so they are triangles of the triangulation of
+            // the boundary vertices with no point inside the circumcircle.
+            {
+                std::vector<std::pair<Point, std::uint32_t>> boundary_points;
+                for (size_t i = 0; i < n; ++i) {
+                    if (on_boundary[i]) {
+                        boundary_points.push_back(
+                            {points[i].first, static_cast<std::uint32_t>(i)});
+                    }
+                }
+                std::vector<char>().swap(on_boundary);
+                PartDt boundary;
+                boundary.insert(boundary_points.begin(), boundary_points.end());
+                for (auto f = boundary.finite_faces_begin();
+                     f != boundary.finite_faces_end(); ++f) {
+                    Triangle t {{f->vertex(0)->info(), f->vertex(1)->info(),
+                        f->vertex(2)->info()}};
+                    const Point &a {f->vertex(0)->point()};
+                    const Point &b {f->vertex(1)->point()};
+                    const Point &p {f->vertex(2)->point()};
+                    Circle c {circumcircle(a, b, p)};
+                    size_t s {strip_of(strips, t.v[0])};
+                    if (strip_of(strips, t.v[1]) == s &&
+                        strip_of(strips, t.v[2]) == s &&
+                        is_within(c, strips[s])) continue;
+                    if (is_empty(c, a, b, p, strips, parts)) faces.push_back(t);
+                }
+            }
+            parts.clear();
+            parts.shrink_to_fit();
+
+            if (!link_triangles(T, points, faces, n_threads)) {
+                std::cout << "Could not merge the triangulations of "
+                    << strips.size() << " strips, building the TIN serially."
+                    << std::endl;
+                T.clear();
+                return false;
+            }
+            return true;
+        }
+
+    }
+
+}
+
+#endif
@@ -0,0 +1,45 @@
+#ifndef PARALLEL_DELAUNAY_H_
+#define PARALLEL_DELAUNAY_H_
+
+#include <utility>
+#include <vector>
+
+#include "TIN.h"
+
+#ifndef COMPACT_TIN
+
+namespace io {
+
+    namespace point_cloud {
+
+        /**
+         * \brief Build the Delaunay triangulation of the points in
+         * n_threads threads.
+         *
+         * The points are split into vertical strips that are triangulated
+         * concurrently. A triangle of a strip whose circumcircle lies
+         * within the strip is a triangle of the whole triangulation. The
+         * vertices of the other triangles are triangulated again together,
+         * and the triangles of that triangulation that have no point of
+         * any strip inside their circumcircle complete the triangulation.
+         * The triangles are then linked into T, which must be empty.
+         *
+         * The points must be sorted by x and then by y, and there must not
+         * be two points with the same x and y. Return false, leaving T
+         * empty, if there are too few points for the parallel construction
+         * to pay off or if the triangles could not be merged into a valid
+         * triangulation, in which case the points should be inserted
+         * serially.
+         */
+        bool build_delaunay_parallel(
+            TIN::Delaunay_triangulation &T,
+            const std::vector<std::pair<TIN::Point, TIN::VertexInfo>> &points,
+            unsigned int n_threads);
+
+    }
+
+}
+
+#endif
+
+#endif
@@ -0,0 +1,204 @@
+#include "PointBatchFilter.h"
+
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+#include <boost/lexical_cast.hpp>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include "PointCloudDataSource.h"
+
+namespace {
+
+    /**
+     * \brief Return the smallest integer X for which scale * X + offset
+     * >= value, using the same floating point operations as LASlib.
+     */
+    long long lower_limit(double value, double scale, double offset)
+    {
+        long long X {static_cast<long long>(std::ceil((value - offset) / scale))};
+        while (scale * (X - 1) + offset >= value) --X;
+        while (scale * X + offset < value) ++X;
+        return X;
+    }
+
+    /**
+     * \brief Return the largest integer X for which scale * X + offset
+     * <= value.
+     */
+    long long upper_limit(double value, double scale, double offset)
+    {
+        long long X {static_cast<long long>(std::floor((value - offset) / scale))};
+        while (scale * (X + 1) + offset <= value) ++X;
+        while (scale * X + offset > value) --X;
+        return X;
+    }
+
+    std::int32_t clamp_to_int32(long long v)
+    {
+        if (v < std::numeric_limits<std::int32_t>::min())
+            return std::numeric_limits<std::int32_t>::min();
+        if (v > std::numeric_limits<std::int32_t>::max())
+            return std::numeric_limits<std::int32_t>::max();
+        return static_cast<std::int32_t>(v);
+    }
+
+}
+
+namespace io {
+
+    namespace point_cloud {
+
+        PointBatchFilter::PointBatchFilter(
+                const std::vector<FilterParams> &filter_params,
+                const Quantization &q):
+            has_window_ {false},
+            X_min_ {std::numeric_limits<std::int32_t>::min()},
+            X_max_ {std::numeric_limits<std::int32_t>::max()},
+            Y_min_ {std::numeric_limits<std::int32_t>::min()},
+            Y_max_ {std::numeric_limits<std::int32_t>::max()},
+            has_classes_ {false}
+        {
+            class_mask_.fill(~static_cast<std::uint64_t>(0));
+            for (const auto &par: filter_params)
+            {
+                if (par.first == PointFilterType::KEEP_WINDOW) {
+                    PointFilterKeepWindow<LASpoint> w {par.second};
+                    has_window_ = true;
+                    long long xmin {lower_limit(w.left(), q.x_scale, q.x_offset)};
+                    long long xmax {upper_limit(w.right(), q.x_scale, q.x_offset)};
+                    long long ymin {lower_limit(w.bottom(), q.y_scale, q.y_offset)};
+                    long long ymax {upper_limit(w.top(), q.y_scale, q.y_offset)};
+                    X_min_ = std::max(X_min_, clamp_to_int32(xmin));
+                    X_max_ = std::min(X_max_, clamp_to_int32(xmax));
+                    Y_min_ = std::max(Y_min_, clamp_to_int32(ymin));
+                    Y_max_ = std::min(Y_max_, clamp_to_int32(ymax));
+                    // A window outside of the integer range keeps nothing.
+                    if (xmin > std::numeric_limits<std::int32_t>::max() ||
+                        xmax < std::numeric_limits<std::int32_t>::min() ||
+                        ymin > std::numeric_limits<std::int32_t>::max() ||
+                        ymax < std::numeric_limits<std::int32_t>::min()) {
+                        X_min_ = 1;
+                        X_max_ = 0;
+                    }
+                } else if (par.first == PointFilterType::KEEP_CLASSES) {
+                    std::array<std::uint64_t, 4> mask;
+                    mask.fill(0);
+                    for (const auto &s: par.second) {
+                        int c {boost::lexical_cast<int>(s)};
+                        if (c < 0 || c > 255) continue;
+                        mask[static_cast<size_t>(c) >> 6] |=
+                            static_cast<std::uint64_t>(1) << (c & 63);
+                    }
+                    has_classes_ = true;
+                    for (size_t i = 0; i < mask.size(); ++i) {
+                        class_mask_[i] &= mask[i];
+                    }
+                }
+            }
+        }
+
+        bool PointBatchFilter::rejects_all() const
+        {
+            if (has_window_ && (X_min_ > X_max_ || Y_min_ > Y_max_))
+                return true;
+            if (has_classes_) {
+                for (auto m: class_mask_) {
+                    if (m) return false;
+                }
+                return true;
+            }
+            return false;
+        }
+
+        size_t PointBatchFilter::apply_scalar(
+            const PointBlock &block,
+            size_t begin,
+            std::uint32_t *selected,
+            size_t n_selected) const
+        {
+            for (size_t i = begin; i < block.size; ++i) {
+                bool keep {
+                    block.X[i] >= X_min_ && block.X[i] <= X_max_ &&
+                    block.Y[i] >= Y_min_ && block.Y[i] <= Y_max_ &&
+                    keeps_class(block.classification[i])};
+                // Branchless compaction: the index is always written but
+                // the output position advances only for the kept points.
+                selected[n_selected] = static_cast<std::uint32_t>(i);
+                n_selected += keep ? 1 : 0;
+            }
+            return n_selected;
+        }
+
+        size_t PointBatchFilter::apply_records(
+            const char *records,
+            size_t record_length,
+            size_t n,
+            size_t class_offset,
+            std::uint8_t class_bits,
+            std::uint32_t *selected) const
+        {
+            size_t n_selected {0};
+            const char *rec {records};
+            for (size_t i = 0; i < n; ++i, rec += record_length) {
+                std::int32_t X, Y;
+                std::memcpy(&X, rec, sizeof(X));
+                std::memcpy(&Y, rec + 4, sizeof(Y));
+                std::uint8_t c {static_cast<std::uint8_t>(
+                    static_cast<std::uint8_t>(rec[class_offset]) & class_bits)};
+                bool keep {
+                    X >= X_min_ && X <= X_max_ &&
+                    Y >= Y_min_ && Y <= Y_max_ &&
+                    keeps_class(c)};
+                selected[n_selected] = static_cast<std::uint32_t>(i);
+                n_selected += keep ? 1 : 0;
+            }
+            return n_selected;
+        }
+
+        size_t PointBatchFilter::apply(
+            const PointBlock &block,
+            std::uint32_t *selected) const
+        {
+            size_t n_selected {0};
+            size_t i {0};
+        #if defined(__SSE2__)
+            const __m128i x_min {_mm_set1_epi32(X_min_)};
+            const __m128i x_max {_mm_set1_epi32(X_max_)};
+            const __m128i y_min {_mm_set1_epi32(Y_min_)};
+            const __m128i y_max {_mm_set1_epi32(Y_max_)};
+            for (; i + 4 <= block.size; i += 4) {
+                __m128i x {_mm_loadu_si128(
+                    reinterpret_cast<const __m128i*>(&block.X[i]))};
+                __m128i y {_mm_loadu_si128(
+                    reinterpret_cast<const __m128i*>(&block.Y[i]))};
+                __m128i outside {_mm_or_si128(
+                    _mm_or_si128(_mm_cmplt_epi32(x, x_min),
+                                 _mm_cmpgt_epi32(x, x_max)),
+                    _mm_or_si128(_mm_cmplt_epi32(y, y_min),
+                                 _mm_cmpgt_epi32(y, y_max)))};
+                int keep {~_mm_movemask_ps(_mm_castsi128_ps(outside)) & 0xf};
+                // SSE2 has no byte shuffle or gather for the lookup of the
+                // class mask, so the classes are tested one at a time, but
+                // without branches.
+                const std::uint8_t *c {&block.classification[i]};
+                keep &= static_cast<int>(keeps_class(c[0])) |
+                    static_cast<int>(keeps_class(c[1])) << 1 |
+                    static_cast<int>(keeps_class(c[2])) << 2 |
+                    static_cast<int>(keeps_class(c[3])) << 3;
+                for (int j = 0; j < 4; ++j) {
+                    selected[n_selected] = static_cast<std::uint32_t>(i + j);
+                    n_selected += (keep >> j) & 1;
+                }
+            }
+        #endif
+            return apply_scalar(block, i, selected, n_selected);
+        }
+
+    }
+
+}
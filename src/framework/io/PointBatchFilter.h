@@ -0,0 +1,88 @@
+#ifndef POINT_BATCH_FILTER_H_
+#define POINT_BATCH_FILTER_H_
+
+#include <array>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "PointBlock.h"
+
+namespace io {
+
+    namespace point_cloud {
+
+        enum class PointFilterType;
+
+        /**
+         * \brief Apply the point filters to whole blocks of points.
+         *
+         * The window limits are converted once to the integer space of the
+         * file, so that the points can be tested without scaling them. The
+         * result is the same as testing the scaled coordinates against the
+         * original limits. The classes are tested against a 256-bit mask.
+         *
+         * With SSE2, apply() compares the coordinates of four points at a
+         * time, but the classes are looked up from the mask one point at a
+         * time. apply_records() is scalar, because the coordinates of the
+         * records are not contiguous.
+         */
+        class PointBatchFilter
+        {
+            public:
+                PointBatchFilter(
+                    const std::vector<std::pair<PointFilterType,
+                        std::vector<std::string>>> &filter_params,
+                    const Quantization &q);
+
+                /**
+                 * \brief Write the indexes of the points of the block that
+                 * pass all the filters to \a selected and return their
+                 * number. \a selected must have room for block.size indexes.
+                 */
+                size_t apply(
+                    const PointBlock &block,
+                    std::uint32_t *selected) const;
+
+                /**
+                 * \brief Same as apply() for \a n points stored in place
+                 * as fixed size LAS point records. The class is read from
+                 * the byte at \a class_offset masked with \a class_bits.
+                 */
+                size_t apply_records(
+                    const char *records,
+                    size_t record_length,
+                    size_t n,
+                    size_t class_offset,
+                    std::uint8_t class_bits,
+                    std::uint32_t *selected) const;
+
+                /**
+                 * \brief Return true if no point can pass the filters.
+                 */
+                bool rejects_all() const;
+
+            private:
+                bool has_window_;
+                std::int32_t X_min_, X_max_, Y_min_, Y_max_;
+                bool has_classes_;
+                std::array<std::uint64_t, 4> class_mask_;
+
+                bool keeps_class(std::uint8_t c) const
+                {
+                    return (class_mask_[c >> 6] >> (c & 63)) & 1;
+                }
+
+                size_t apply_scalar(
+                    const PointBlock &block,
+                    size_t begin,
+                    std::uint32_t *selected,
+                    size_t n_selected) const;
+        };
+
+    }
+
+}
+
+#endif
@@ -0,0 +1,85 @@
+#ifndef POINT_BLOCK_H_
+#define POINT_BLOCK_H_
+
+#include <array>
+#include <cstdint>
+#include <cstddef>
+
+namespace io {
+
+    namespace point_cloud {
+
+        /**
+         * \brief The scale and offset of the LAS integer coordinates.
+         *
+         * The real coordinates are computed as in LASlib, i.e.
+         * x = x_scale * X + x_offset.
+         */
+        class Quantization
+        {
+            public:
+                Quantization():
+                    x_scale {1}, y_scale {1}, z_scale {1},
+                    x_offset {0}, y_offset {0}, z_offset {0}
+                {
+                }
+
+                double x_scale, y_scale, z_scale;
+                double x_offset, y_offset, z_offset;
+
+                double x(std::int32_t X) const { return x_scale * X + x_offset; }
+                double y(std::int32_t Y) const { return y_scale * Y + y_offset; }
+                double z(std::int32_t Z) const { return z_scale * Z + z_offset; }
+
+                bool operator==(const Quantization &q) const
+                {
+                    return x_scale == q.x_scale && y_scale == q.y_scale &&
+                        z_scale == q.z_scale && x_offset == q.x_offset &&
+                        y_offset == q.y_offset && z_offset == q.z_offset;
+                }
+        };
+
+        /**
+         * \brief A block of decoded points in the LAS integer space stored
+         * as a structure of arrays.
+         */
+        class PointBlock
+        {
+            public:
+                static constexpr size_t capacity {1024};
+
+                PointBlock(): size {0}
+                {
+                }
+
+                Quantization quantization;
+                size_t size;
+                std::array<std::int32_t, capacity> X;
+                std::array<std::int32_t, capacity> Y;
+                std::array<std::int32_t, capacity> Z;
+                std::array<std::uint8_t, capacity> classification;
+
+                bool full() const { return size == capacity; }
+                void clear() { size = 0; }
+
+                void push_back(
+                    std::int32_t x, std::int32_t y, std::int32_t z,
+                    std::uint8_t c)
+                {
+                    X[size] = x;
+                    Y[size] = y;
+                    Z[size] = z;
+                    classification[size] = c;
+                    ++size;
+                }
+
+                double x(size_t i) const { return quantization.x(X[i]); }
+                double y(size_t i) const { return quantization.y(Y[i]); }
+                double z(size_t i) const { return quantization.z(Z[i]); }
+        };
+
+    }
+
+}
+
+#endif
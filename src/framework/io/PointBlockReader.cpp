@@ -0,0 +1,179 @@
+#include "PointBlockReader.h"
+
+#include <algorithm>
+#include <limits>
+#include <sstream>
+
+#include <boost/algorithm/string.hpp>
+#include <lasreader.hpp>
+#include <laszip_decompress_selective_v3.hpp>
+
+#include "BoundingBox.h"
+#include "MappedLasFile.h"
+#include "PointCloudDataSource.h"
+
+namespace io {
+
+    namespace point_cloud {
+
+        constexpr size_t PointBlock::capacity;
+
+        /**
+         * \brief Return the LASzip layers needed by the filters.
+         *
+         * Only x, y and z are needed for the TIN, the classification only
+         * when the points are filtered by class. The selection has an
+         * effect on the layered point formats 6-10 only, the older
+         * formats are always decompressed fully.
+         */
+        U32 decompress_selective(
+            const std::vector<FilterParams> &filter_params)
+        {
+            U32 layers {LASZIP_DECOMPRESS_SELECTIVE_CHANNEL_RETURNS_XY |
+                LASZIP_DECOMPRESS_SELECTIVE_Z};
+            for (const auto &par: filter_params) {
+                if (par.first == PointFilterType::KEEP_CLASSES) {
+                    layers |= LASZIP_DECOMPRESS_SELECTIVE_CLASSIFICATION;
+                }
+            }
+            return layers;
+        }
+
+        PointBlockReader::PointBlockReader(
+                const std::string &filename,
+                const std::vector<FilterParams> &filter_params):
+            next_record_ {0},
+            end_record_ {0},
+            overlaps_ {true}
+        {
+            geo::BoundingBox bb;
+            if (boost::algorithm::ends_with(filename, ".las")) {
+                las_.reset(new MappedLasFile(filename));
+                quantization_ = las_->quantization();
+                bb.add({las_->min_x(), las_->min_y()});
+                bb.add({las_->max_x(), las_->max_y()});
+            } else {
+                LASreadOpener lro;
+                lro.set_file_name(filename.c_str());
+                lro.set_decompress_selective(
+                    decompress_selective(filter_params));
+                laz_.reset(lro.open());
+                if (!laz_) {
+                    std::stringstream ss;
+                    ss << "Failed to open the file '" << filename << "'.";
+                    throw std::runtime_error(ss.str());
+                }
+                const LASheader &h {laz_->header};
+                quantization_.x_scale = h.x_scale_factor;
+                quantization_.y_scale = h.y_scale_factor;
+                quantization_.z_scale = h.z_scale_factor;
+                quantization_.x_offset = h.x_offset;
+                quantization_.y_offset = h.y_offset;
+                quantization_.z_offset = h.z_offset;
+                bb.add({laz_->get_min_x(), laz_->get_min_y()});
+                bb.add({laz_->get_max_x(), laz_->get_max_y()});
+            }
+
+            end_record_ = number_of_points();
+
+            for (const auto &par: filter_params)
+            {
+                if (par.first == PointFilterType::KEEP_WINDOW)
+                {
+                    PointFilterKeepWindow<LASpoint> f {par.second};
+                    if (!bb.overlaps_with(f)) {
+                        overlaps_ = false;
+                    } else if (laz_) {
+                        // With a .lax index loaded by LASreadOpener, only
+                        // the intervals overlapping the window are read.
+                        // Without it this just skips the points outside.
+                        // LASlib leaves out the points on the right and
+                        // top edges, so the rectangle is widened by one
+                        // unit and the window itself is tested by the
+                        // point filters as for the .las files.
+                        laz_->inside_rectangle(
+                            f.left(), f.bottom(),
+                            f.right() + quantization_.x_scale,
+                            f.top() + quantization_.y_scale);
+                    }
+                }
+            }
+        }
+
+        PointBlockReader::~PointBlockReader()
+        {
+        }
+
+        bool PointBlockReader::uses_index() const
+        {
+            return laz_ && laz_->get_index();
+        }
+
+        std::uint64_t PointBlockReader::number_of_points() const
+        {
+            if (las_) return las_->number_of_points();
+            return static_cast<std::uint64_t>(laz_->npoints);
+        }
+
+        std::uint64_t PointBlockReader::chunk_size() const
+        {
+            if (!laz_ || !laz_->header.laszip) return 0;
+            U32 size {laz_->header.laszip->chunk_size};
+            // The variable sized chunks are marked with U32_MAX.
+            if (size == std::numeric_limits<U32>::max()) return 0;
+            return size;
+        }
+
+        void PointBlockReader::restrict_to(
+            std::uint64_t first,
+            std::uint64_t count)
+        {
+            first = std::min(first, number_of_points());
+            next_record_ = first;
+            end_record_ = std::min(first + count, number_of_points());
+            if (laz_) {
+                // The points of the range are read sequentially from the
+                // beginning of the range, so the window is left to the
+                // point filters.
+                laz_->inside_none();
+                if (!laz_->seek(static_cast<I64>(first))) {
+                    throw std::runtime_error(
+                        "Failed to seek in the point cloud file.");
+                }
+            }
+        }
+
+        bool PointBlockReader::read(PointBlock &block)
+        {
+            block.clear();
+            block.quantization = quantization_;
+            if (las_) {
+                std::uint64_t n {std::min<std::uint64_t>(
+                    PointBlock::capacity,
+                    end_record_ - next_record_)};
+                for (std::uint64_t i = 0; i < n; ++i) {
+                    const char *rec {las_->record(next_record_ + i)};
+                    block.push_back(
+                        MappedLasFile::X(rec), MappedLasFile::Y(rec),
+                        MappedLasFile::Z(rec),
+                        static_cast<std::uint8_t>(
+                            static_cast<std::uint8_t>(rec[las_->class_offset()]) &
+                            las_->class_bits()));
+                }
+                next_record_ += n;
+            } else {
+                while (!block.full() &&
+                       static_cast<std::uint64_t>(laz_->p_count) < end_record_ &&
+                       laz_->read_point()) {
+                    const LASpoint &point = laz_->point;
+                    block.push_back(
+                        point.get_X(), point.get_Y(), point.get_Z(),
+                        static_cast<std::uint8_t>(get_class(point)));
+                }
+            }
+            return block.size > 0;
+        }
+
+    }
+
+}
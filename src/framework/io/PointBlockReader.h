@@ -0,0 +1,83 @@
+#ifndef POINT_BLOCK_READER_H_
+#define POINT_BLOCK_READER_H_
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "PointBlock.h"
+
+class LASreader;
+
+namespace io {
+
+    namespace point_cloud {
+
+        enum class PointFilterType;
+        class MappedLasFile;
+
+        /**
+         * \brief Sequential reader of the points of a .laz or .las file in
+         * blocks.
+         *
+         * The .laz files are restricted to the keep_window area with the
+         * .lax index when there is one, and only the LASzip layers needed
+         * by the filters are decompressed. The .las files are read from a
+         * memory mapping. The points are not filtered by the reader.
+         */
+        class PointBlockReader
+        {
+            public:
+                PointBlockReader(
+                    const std::string &filename,
+                    const std::vector<std::pair<PointFilterType,
+                        std::vector<std::string>>> &filter_params);
+                ~PointBlockReader();
+                PointBlockReader(const PointBlockReader &) = delete;
+
+                /**
+                 * \brief Return false if the bounds of the file do not
+                 * overlap the keep_window filters.
+                 */
+                bool overlaps() const { return overlaps_; }
+                bool uses_index() const;
+                std::uint64_t number_of_points() const;
+                const Quantization & quantization() const { return quantization_; }
+
+                /**
+                 * \brief Return the number of points in a LAZ chunk, or 0
+                 * if the file is not compressed in chunks of a fixed size.
+                 */
+                std::uint64_t chunk_size() const;
+
+                /**
+                 * \brief Read only the \a count points starting from the
+                 * point \a first.
+                 *
+                 * The spatial index is not used for a restricted range, all
+                 * the points of the range are decoded.
+                 */
+                void restrict_to(std::uint64_t first, std::uint64_t count);
+
+                /**
+                 * \brief Replace the contents of the block with the next
+                 * points. Return false if there were no points left.
+                 */
+                bool read(PointBlock &block);
+
+            private:
+                std::unique_ptr<LASreader> laz_;
+                std::unique_ptr<MappedLasFile> las_;
+                std::uint64_t next_record_;
+                std::uint64_t end_record_;
+                Quantization quantization_;
+                bool overlaps_;
+        };
+
+    }
+
+}
+
+#endif
@@ -0,0 +1,63 @@
+#include "PointBuffer.h"
+
+#include "Interpolator.h"
+
+namespace io {
+
+    namespace point_cloud {
+
+        PointBuffer::PointBuffer()
+        {
+        }
+
+        void PointBuffer::insert_point(const geo::GeoCoordinate &p, double elev)
+        {
+            x_.push_back(p.x());
+            y_.push_back(p.y());
+            z_.push_back(elev);
+        }
+
+        void PointBuffer::reserve(size_t n)
+        {
+            x_.reserve(n);
+            y_.reserve(n);
+            z_.reserve(n);
+        }
+
+        void PointBuffer::clear()
+        {
+            // Release the memory as well, the buffers can be large.
+            std::vector<double>().swap(x_);
+            std::vector<double>().swap(y_);
+            std::vector<double>().swap(z_);
+        }
+
+        void PointBuffer::reset()
+        {
+            x_.clear();
+            y_.clear();
+            z_.clear();
+        }
+
+        size_t PointBuffer::size() const
+        {
+            return x_.size();
+        }
+
+        void PointBuffer::insert_to(Interpolator &ip) const
+        {
+            for (size_t i = 0; i < size(); ++i) {
+                ip.insert_point(geo::GeoCoordinate {x_[i], y_[i]}, z_[i]);
+            }
+        }
+
+        void PointBuffer::insert_to(PointBuffer &buffer) const
+        {
+            buffer.x_.insert(buffer.x_.end(), x_.begin(), x_.end());
+            buffer.y_.insert(buffer.y_.end(), y_.begin(), y_.end());
+            buffer.z_.insert(buffer.z_.end(), z_.begin(), z_.end());
+        }
+
+    }
+
+}
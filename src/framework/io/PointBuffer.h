@@ -0,0 +1,61 @@
+#ifndef POINT_BUFFER_H_
+#define POINT_BUFFER_H_
+
+#include <vector>
+#include <cstddef>
+
+#include "framework/geo.h"
+
+namespace io {
+
+    namespace point_cloud {
+
+        class Interpolator;
+
+        /**
+         * \brief A plain list of filtered (x, y, z) points.
+         *
+         * The buffer has the same insert_point() interface as the
+         * Interpolator so that the readers can fill either one. The points
+         * are kept in the insertion order.
+         */
+        class PointBuffer
+        {
+            public:
+                PointBuffer();
+
+                void insert_point(const geo::GeoCoordinate &, double elev);
+                void reserve(size_t n);
+                void clear();
+                /**
+                 * \brief Remove the points but keep the allocated memory
+                 * for reusing the buffer.
+                 */
+                void reset();
+                size_t size() const;
+
+                double x(size_t i) const { return x_[i]; }
+                double y(size_t i) const { return y_[i]; }
+                double z(size_t i) const { return z_[i]; }
+
+                /**
+                 * \brief Insert all the points to the interpolator in the
+                 * order they were added to the buffer.
+                 */
+                void insert_to(Interpolator &ip) const;
+                /**
+                 * \brief Append all the points to another buffer.
+                 */
+                void insert_to(PointBuffer &buffer) const;
+
+            private:
+                std::vector<double> x_;
+                std::vector<double> y_;
+                std::vector<double> z_;
+        };
+
+    }
+
+}
+
+#endif
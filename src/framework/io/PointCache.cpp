@@ -0,0 +1,253 @@
+#include "PointCache.h"
+
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "PointBuffer.h"
+
+namespace {
+
+    const char cache_magic[8] {'P', 'C', 'P', 'T', 'S', '0', '0', '1'};
+
+    // Offsets of the fields of the header of a cache file.
+    const size_t key_offset {8};
+    const size_t n_points_offset {16};
+    const size_t scale_offset {24};
+    const size_t offset_offset {48};
+    const size_t header_size {72};
+
+    template<typename T>
+    T read_at(const char *data, size_t offset)
+    {
+        T value;
+        std::memcpy(&value, data + offset, sizeof(T));
+        return value;
+    }
+
+    template<typename T>
+    void write_value(std::ostream &os, const T &value)
+    {
+        os.write(reinterpret_cast<const char*>(&value), sizeof(T));
+    }
+
+    /**
+     * \brief 64-bit FNV-1a hash.
+     */
+    class Hash
+    {
+        public:
+            Hash(): h_ {0xcbf29ce484222325ULL}
+            {
+            }
+
+            void add(const void *data, size_t n)
+            {
+                const unsigned char *p {static_cast<const unsigned char*>(data)};
+                for (size_t i = 0; i < n; ++i) {
+                    h_ ^= p[i];
+                    h_ *= 0x100000001b3ULL;
+                }
+            }
+
+            void add(const std::string &s)
+            {
+                // The length separates the consecutive strings.
+                std::uint64_t n {s.size()};
+                add(&n, sizeof(n));
+                add(s.data(), s.size());
+            }
+
+            std::uint64_t value() const { return h_; }
+
+        private:
+            std::uint64_t h_;
+    };
+
+    std::int32_t quantize(double v, double scale, double offset)
+    {
+        return static_cast<std::int32_t>(std::llround((v - offset) / scale));
+    }
+
+}
+
+namespace io {
+
+    namespace point_cloud {
+
+        CachedPoints::CachedPoints(
+                const boost::filesystem::path &filename,
+                std::uint64_t key):
+            fd_ {-1}, data_ {nullptr}, size_ {0}, n_points_ {0},
+            X_ {nullptr}, Y_ {nullptr}, Z_ {nullptr}
+        {
+            fd_ = ::open(filename.string().c_str(), O_RDONLY);
+            if (fd_ < 0) {
+                std::stringstream ss;
+                ss << "Failed to open the file '" << filename.string() << "'.";
+                throw std::runtime_error(ss.str());
+            }
+            struct stat st;
+            if (fstat(fd_, &st) != 0 ||
+                static_cast<size_t>(st.st_size) < header_size) {
+                close(fd_);
+                std::stringstream ss;
+                ss << "The file '" << filename.string()
+                    << "' is not a point cache file.";
+                throw std::runtime_error(ss.str());
+            }
+            size_ = static_cast<size_t>(st.st_size);
+            void *p {mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd_, 0)};
+            if (p == MAP_FAILED) {
+                close(fd_);
+                std::stringstream ss;
+                ss << "Failed to map the file '" << filename.string() << "'.";
+                throw std::runtime_error(ss.str());
+            }
+            data_ = static_cast<char*>(p);
+            madvise(data_, size_, MADV_SEQUENTIAL);
+
+            n_points_ = read_at<std::uint64_t>(data_, n_points_offset);
+            if (std::memcmp(data_, cache_magic, sizeof(cache_magic)) != 0 ||
+                read_at<std::uint64_t>(data_, key_offset) != key ||
+                size_ != header_size + 3 * sizeof(std::int32_t) * n_points_) {
+                munmap(data_, size_);
+                close(fd_);
+                std::stringstream ss;
+                ss << "The point cache file '" << filename.string()
+                    << "' is invalid.";
+                throw std::runtime_error(ss.str());
+            }
+            quantization_.x_scale = read_at<double>(data_, scale_offset);
+            quantization_.y_scale = read_at<double>(data_, scale_offset + 8);
+            quantization_.z_scale = read_at<double>(data_, scale_offset + 16);
+            quantization_.x_offset = read_at<double>(data_, offset_offset);
+            quantization_.y_offset = read_at<double>(data_, offset_offset + 8);
+            quantization_.z_offset = read_at<double>(data_, offset_offset + 16);
+            X_ = data_ + header_size;
+            Y_ = X_ + sizeof(std::int32_t) * n_points_;
+            Z_ = Y_ + sizeof(std::int32_t) * n_points_;
+        }
+
+        CachedPoints::~CachedPoints()
+        {
+            if (data_) {
+                munmap(data_, size_);
+                data_ = nullptr;
+            }
+            if (fd_ >= 0) {
+                close(fd_);
+                fd_ = -1;
+            }
+        }
+
+        PointCache::PointCache(const boost::filesystem::path &dir):
+            dir_ {dir}
+        {
+            boost::filesystem::create_directories(dir_);
+        }
+
+        std::uint64_t PointCache::key(
+            const boost::filesystem::path &file,
+            const std::vector<FilterParams> &filter_params) const
+        {
+            Hash h;
+            h.add(boost::filesystem::absolute(file).string());
+            std::int64_t mtime {static_cast<std::int64_t>(
+                boost::filesystem::last_write_time(file))};
+            std::uint64_t size {boost::filesystem::file_size(file)};
+            h.add(&mtime, sizeof(mtime));
+            h.add(&size, sizeof(size));
+            for (const auto &par: filter_params) {
+                int type {static_cast<int>(par.first)};
+                h.add(&type, sizeof(type));
+                for (const auto &s: par.second) h.add(s);
+            }
+            return h.value();
+        }
+
+        boost::filesystem::path PointCache::cache_filename(
+            std::uint64_t key) const
+        {
+            std::stringstream ss;
+            ss << std::hex << std::setw(16) << std::setfill('0') << key
+                << ".pts";
+            return dir_ / ss.str();
+        }
+
+        std::unique_ptr<CachedPoints> PointCache::open(
+            const boost::filesystem::path &file,
+            const std::vector<FilterParams> &filter_params) const
+        {
+            std::uint64_t k {key(file, filter_params)};
+            boost::filesystem::path fname {cache_filename(k)};
+            if (!boost::filesystem::exists(fname)) return nullptr;
+            try {
+                return std::unique_ptr<CachedPoints>(new CachedPoints(fname, k));
+            } catch (std::runtime_error &e) {
+                std::cout << "Ignoring the cached points: " << e.what()
+                    << std::endl;
+                return nullptr;
+            }
+        }
+
+        void PointCache::save(
+            const boost::filesystem::path &file,
+            const std::vector<FilterParams> &filter_params,
+            const PointBuffer &points,
+            const Quantization &q) const
+        {
+            std::uint64_t k {key(file, filter_params)};
+            boost::filesystem::path fname {cache_filename(k)};
+            // The threads and the runs saving the same file each write to
+            // a file of their own.
+            boost::filesystem::path tmp_fname {fname};
+            tmp_fname += "." + boost::filesystem::unique_path().string() + ".tmp";
+            {
+                std::ofstream os(tmp_fname.string(), std::ios::binary);
+                if (!os) {
+                    std::cout << "Failed to write the point cache file '"
+                        << fname.string() << "'." << std::endl;
+                    return;
+                }
+                os.write(cache_magic, sizeof(cache_magic));
+                write_value(os, k);
+                write_value(os, static_cast<std::uint64_t>(points.size()));
+                write_value(os, q.x_scale);
+                write_value(os, q.y_scale);
+                write_value(os, q.z_scale);
+                write_value(os, q.x_offset);
+                write_value(os, q.y_offset);
+                write_value(os, q.z_offset);
+                for (size_t i = 0; i < points.size(); ++i) {
+                    write_value(os, quantize(points.x(i), q.x_scale, q.x_offset));
+                }
+                for (size_t i = 0; i < points.size(); ++i) {
+                    write_value(os, quantize(points.y(i), q.y_scale, q.y_offset));
+                }
+                for (size_t i = 0; i < points.size(); ++i) {
+                    write_value(os, quantize(points.z(i), q.z_scale, q.z_offset));
+                }
+                if (!os) {
+                    std::cout << "Failed to write the point cache file '"
+                        << fname.string() << "'." << std::endl;
+                    os.close();
+                    boost::filesystem::remove(tmp_fname);
+                    return;
+                }
+            }
+            // Other runs see only complete cache files.
+            boost::filesystem::rename(tmp_fname, fname);
+        }
+
+    }
+
+}
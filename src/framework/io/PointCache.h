@@ -0,0 +1,125 @@
+#ifndef POINT_CACHE_H_
+#define POINT_CACHE_H_
+
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <boost/filesystem.hpp>
+
+#include "framework/geo.h"
+#include "PointBlock.h"
+#include "PointCloudDataSource.h"
+
+namespace io {
+
+    namespace point_cloud {
+
+        class PointBuffer;
+
+        /**
+         * \brief Read-only memory mapping of a file of cached points.
+         *
+         * The file starts with a fixed size header followed by the X, Y
+         * and Z columns of the points as int32 values in the LAS integer
+         * space of the source file.
+         */
+        class CachedPoints
+        {
+            public:
+                CachedPoints(
+                    const boost::filesystem::path &filename,
+                    std::uint64_t key);
+                ~CachedPoints();
+                CachedPoints(const CachedPoints &) = delete;
+                CachedPoints & operator=(const CachedPoints &) = delete;
+
+                std::uint64_t size() const { return n_points_; }
+                const Quantization & quantization() const { return quantization_; }
+
+                double x(std::uint64_t i) const { return quantization_.x(column(X_, i)); }
+                double y(std::uint64_t i) const { return quantization_.y(column(Y_, i)); }
+                double z(std::uint64_t i) const { return quantization_.z(column(Z_, i)); }
+
+                /**
+                 * \brief Insert all the points to the sink in the order
+                 * they were cached.
+                 */
+                template<typename Sink>
+                void insert_to(Sink &sink) const
+                {
+                    for (std::uint64_t i = 0; i < n_points_; ++i) {
+                        sink.insert_point(geo::GeoCoordinate {x(i), y(i)}, z(i));
+                    }
+                }
+
+            private:
+                int fd_;
+                char *data_;
+                size_t size_;
+                std::uint64_t n_points_;
+                Quantization quantization_;
+                const char *X_;
+                const char *Y_;
+                const char *Z_;
+
+                static std::int32_t column(const char *col, std::uint64_t i)
+                {
+                    std::int32_t v;
+                    std::memcpy(&v, col + i * sizeof(v), sizeof(v));
+                    return v;
+                }
+        };
+
+        /**
+         * \brief On-disk cache of the filtered points of the point cloud
+         * files.
+         *
+         * The points of each file are stored in their own file in the
+         * cache directory. The name of the file is derived from the path,
+         * the modification time and the size of the source file and from
+         * the filter parameters, so a changed file or a different window
+         * or set of classes never uses stale points.
+         */
+        class PointCache
+        {
+            public:
+                explicit PointCache(const boost::filesystem::path &dir);
+
+                /**
+                 * \brief Return the cached points of the file, or nullptr
+                 * if the points of the file with these filters are not in
+                 * the cache.
+                 */
+                std::unique_ptr<CachedPoints> open(
+                    const boost::filesystem::path &file,
+                    const std::vector<FilterParams> &filter_params) const;
+
+                /**
+                 * \brief Store the filtered points of the file to the
+                 * cache. The points are converted back to the LAS integer
+                 * space of the file given by its quantization \a q, so
+                 * they are restored exactly.
+                 */
+                void save(
+                    const boost::filesystem::path &file,
+                    const std::vector<FilterParams> &filter_params,
+                    const PointBuffer &points,
+                    const Quantization &q) const;
+
+            private:
+                boost::filesystem::path dir_;
+
+                std::uint64_t key(
+                    const boost::filesystem::path &file,
+                    const std::vector<FilterParams> &filter_params) const;
+                boost::filesystem::path cache_filename(std::uint64_t key) const;
+        };
+
+    }
+
+}
+
+#endif
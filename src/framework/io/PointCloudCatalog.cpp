@@ -0,0 +1,275 @@
+#include "PointCloudCatalog.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <sstream>
+
+#include <lasreader.hpp>
+#include <laszip_decompress_selective_v3.hpp>
+
+#include "PointCloudDataSource.h"
+
+namespace {
+
+    const char catalog_magic[8] {'P', 'C', 'C', 'A', 'T', 'L', 'G', '1'};
+
+    template<typename T>
+    void write_value(std::ostream &os, const T &value)
+    {
+        os.write(reinterpret_cast<const char*>(&value), sizeof(T));
+    }
+
+    template<typename T>
+    T read_value(std::istream &is)
+    {
+        T value;
+        is.read(reinterpret_cast<char*>(&value), sizeof(T));
+        if (!is) throw std::runtime_error("Truncated point cloud catalog.");
+        return value;
+    }
+
+    void write_string(std::ostream &os, const std::string &s)
+    {
+        write_value(os, static_cast<std::uint32_t>(s.size()));
+        os.write(s.data(), static_cast<std::streamsize>(s.size()));
+    }
+
+    std::string read_string(std::istream &is)
+    {
+        auto n = read_value<std::uint32_t>(is);
+        std::string s(n, '\0');
+        is.read(&s[0], static_cast<std::streamsize>(n));
+        if (!is) throw std::runtime_error("Truncated point cloud catalog.");
+        return s;
+    }
+
+    std::string crs_from_header(const LASheader &h)
+    {
+        if (h.vlr_geo_ogc_wkt && h.vlr_geo_ogc_wkt_length > 0) {
+            return std::string(h.vlr_geo_ogc_wkt);
+        }
+        if (h.vlr_geo_keys && h.vlr_geo_key_entries) {
+            for (U16 i = 0; i < h.vlr_geo_keys->number_of_keys; ++i) {
+                const LASvlr_key_entry &e {h.vlr_geo_key_entries[i]};
+                // ProjectedCSTypeGeoKey stored directly in the key entry.
+                if (e.key_id == 3072 && e.tiff_tag_location == 0) {
+                    std::stringstream ss;
+                    ss << "EPSG:" << e.value_offset;
+                    return ss.str();
+                }
+            }
+        }
+        return "";
+    }
+
+}
+
+namespace io {
+
+    namespace point_cloud {
+
+        PointCloudFileInfo::PointCloudFileInfo():
+            mtime {0}, file_size {0}, n_points {0},
+            min_x {0}, max_x {0}, min_y {0}, max_y {0}, min_z {0}, max_z {0}
+        {
+            class_counts.fill(0);
+        }
+
+        bool PointCloudFileInfo::has_class(int c) const
+        {
+            if (c < 0 || c >= static_cast<int>(class_counts.size()))
+                return false;
+            return class_counts[static_cast<size_t>(c)] > 0;
+        }
+
+        PointCloudFileInfo scan_point_cloud_file(
+            const boost::filesystem::path &file)
+        {
+            LASreadOpener lro;
+            lro.set_file_name(file.string().c_str());
+            // The class histogram is the only thing read from the points.
+            lro.set_decompress_selective(
+                LASZIP_DECOMPRESS_SELECTIVE_CHANNEL_RETURNS_XY |
+                LASZIP_DECOMPRESS_SELECTIVE_CLASSIFICATION);
+            std::unique_ptr<LASreader> reader {lro.open()};
+            if (!reader) {
+                std::stringstream ss;
+                ss << "Failed to open the file '" << file.string()
+                    << "' for the catalog.";
+                throw std::runtime_error(ss.str());
+            }
+
+            PointCloudFileInfo info;
+            info.filename = file.filename().string();
+            info.mtime = boost::filesystem::last_write_time(file);
+            info.file_size = boost::filesystem::file_size(file);
+            info.n_points = static_cast<std::uint64_t>(reader->npoints);
+            info.min_x = reader->header.min_x;
+            info.max_x = reader->header.max_x;
+            info.min_y = reader->header.min_y;
+            info.max_y = reader->header.max_y;
+            info.min_z = reader->header.min_z;
+            info.max_z = reader->header.max_z;
+            info.crs = crs_from_header(reader->header);
+
+            while (reader->read_point())
+            {
+                int c {get_class(reader->point)};
+                ++info.class_counts[static_cast<size_t>(c & 0xff)];
+            }
+            reader->close();
+            return info;
+        }
+
+        PointCloudCatalog::PointCloudCatalog(
+                const boost::filesystem::path &dir):
+            dir_ {dir},
+            modified_ {false}
+        {
+        }
+
+        boost::filesystem::path PointCloudCatalog::catalog_filename(
+            const boost::filesystem::path &dir)
+        {
+            return dir / ".point_cloud_catalog";
+        }
+
+        bool PointCloudCatalog::is_up_to_date(
+            const PointCloudFileInfo &info,
+            const boost::filesystem::path &file) const
+        {
+            boost::system::error_code ec;
+            std::time_t mtime {boost::filesystem::last_write_time(file, ec)};
+            if (ec) return false;
+            auto size = boost::filesystem::file_size(file, ec);
+            if (ec) return false;
+            return info.mtime == mtime && info.file_size == size;
+        }
+
+        const PointCloudFileInfo * PointCloudCatalog::find(
+            const boost::filesystem::path &file) const
+        {
+            auto it = entries_.find(file.filename().string());
+            if (it == entries_.end() || !is_up_to_date(it->second, file)) {
+                return nullptr;
+            }
+            return &it->second;
+        }
+
+        const PointCloudFileInfo & PointCloudCatalog::update(
+            const boost::filesystem::path &file)
+        {
+            const PointCloudFileInfo *info {find(file)};
+            if (info) return *info;
+            std::cout << "Adding the file '" << file.string()
+                << "' to the catalog." << std::endl;
+            PointCloudFileInfo &entry =
+                entries_[file.filename().string()];
+            entry = scan_point_cloud_file(file);
+            modified_ = true;
+            return entry;
+        }
+
+        void PointCloudCatalog::load()
+        {
+            boost::filesystem::path fname {catalog_filename(dir_)};
+            if (!boost::filesystem::exists(fname)) return;
+            std::ifstream is(fname.string(), std::ios::binary);
+            char magic[sizeof(catalog_magic)];
+            is.read(magic, sizeof(magic));
+            if (!is || !std::equal(magic, magic + sizeof(magic), catalog_magic)) {
+                std::cout << "Ignoring the invalid catalog '"
+                    << fname.string() << "'." << std::endl;
+                return;
+            }
+            try {
+                auto n = read_value<std::uint64_t>(is);
+                for (std::uint64_t i = 0; i < n; ++i) {
+                    PointCloudFileInfo info;
+                    info.filename = read_string(is);
+                    info.mtime = static_cast<std::time_t>(
+                        read_value<std::int64_t>(is));
+                    info.file_size = read_value<std::uint64_t>(is);
+                    info.n_points = read_value<std::uint64_t>(is);
+                    info.min_x = read_value<double>(is);
+                    info.max_x = read_value<double>(is);
+                    info.min_y = read_value<double>(is);
+                    info.max_y = read_value<double>(is);
+                    info.min_z = read_value<double>(is);
+                    info.max_z = read_value<double>(is);
+                    // Only the non-empty classes are stored.
+                    auto n_classes = read_value<std::uint16_t>(is);
+                    for (std::uint16_t j = 0; j < n_classes; ++j) {
+                        auto c = read_value<std::uint8_t>(is);
+                        info.class_counts[c] = read_value<std::uint64_t>(is);
+                    }
+                    info.crs = read_string(is);
+                    entries_[info.filename] = info;
+                }
+            } catch (std::runtime_error &e) {
+                std::cout << "Ignoring the catalog '" << fname.string()
+                    << "': " << e.what() << std::endl;
+                entries_.clear();
+            }
+            modified_ = false;
+        }
+
+        void PointCloudCatalog::save()
+        {
+            boost::filesystem::path fname {catalog_filename(dir_)};
+            // The runs saving the catalog of the same directory each write
+            // to a file of their own.
+            boost::filesystem::path tmp_fname {fname};
+            tmp_fname += "." + boost::filesystem::unique_path().string() + ".tmp";
+            {
+                std::ofstream os(tmp_fname.string(), std::ios::binary);
+                if (!os) {
+                    std::cout << "Failed to write the catalog '"
+                        << fname.string() << "'." << std::endl;
+                    return;
+                }
+                os.write(catalog_magic, sizeof(catalog_magic));
+                write_value(os, static_cast<std::uint64_t>(entries_.size()));
+                for (const auto &e: entries_) {
+                    const PointCloudFileInfo &info {e.second};
+                    write_string(os, info.filename);
+                    write_value(os, static_cast<std::int64_t>(info.mtime));
+                    write_value(os, info.file_size);
+                    write_value(os, info.n_points);
+                    write_value(os, info.min_x);
+                    write_value(os, info.max_x);
+                    write_value(os, info.min_y);
+                    write_value(os, info.max_y);
+                    write_value(os, info.min_z);
+                    write_value(os, info.max_z);
+                    std::uint16_t n_classes {0};
+                    for (auto count: info.class_counts) {
+                        if (count > 0) ++n_classes;
+                    }
+                    write_value(os, n_classes);
+                    for (size_t c = 0; c < info.class_counts.size(); ++c) {
+                        if (info.class_counts[c] == 0) continue;
+                        write_value(os, static_cast<std::uint8_t>(c));
+                        write_value(os, info.class_counts[c]);
+                    }
+                    write_string(os, info.crs);
+                }
+                os.close();
+                if (!os) {
+                    std::cout << "Failed to write the catalog '"
+                        << fname.string() << "'." << std::endl;
+                    boost::filesystem::remove(tmp_fname);
+                    return;
+                }
+            }
+            // Replace the old catalog only when the new one is complete.
+            boost::filesystem::rename(tmp_fname, fname);
+            modified_ = false;
+        }
+
+    }
+
+}
@@ -0,0 +1,98 @@
+#ifndef POINT_CLOUD_CATALOG_H_
+#define POINT_CLOUD_CATALOG_H_
+
+#include <array>
+#include <cstdint>
+#include <ctime>
+#include <map>
+#include <string>
+
+#include <boost/filesystem.hpp>
+
+namespace io {
+
+    namespace point_cloud {
+
+        /**
+         * \brief Summary of a single point cloud file stored in the catalog.
+         */
+        class PointCloudFileInfo
+        {
+            public:
+                PointCloudFileInfo();
+
+                std::string filename;
+                std::time_t mtime;
+                std::uint64_t file_size;
+                std::uint64_t n_points;
+                double min_x, max_x, min_y, max_y, min_z, max_z;
+                /// Number of points in each class.
+                std::array<std::uint64_t, 256> class_counts;
+                /// WKT or EPSG:<code> string from the header, may be empty.
+                std::string crs;
+
+                double left() const { return min_x; }
+                double right() const { return max_x; }
+                double top() const { return max_y; }
+                double bottom() const { return min_y; }
+
+                bool has_class(int c) const;
+        };
+
+        /**
+         * \brief Read the header and all the points of the file and
+         * collect the summary information.
+         */
+        PointCloudFileInfo scan_point_cloud_file(
+            const boost::filesystem::path &file);
+
+        /**
+         * \brief The catalog of the point cloud files of a single directory.
+         *
+         * The catalog is stored in the sidecar file
+         * <dir>/.point_cloud_catalog so that the files need to be scanned
+         * only once. An entry is valid as long as the modification time and
+         * the size of the file do not change.
+         */
+        class PointCloudCatalog
+        {
+            public:
+                explicit PointCloudCatalog(const boost::filesystem::path &dir);
+
+                static boost::filesystem::path catalog_filename(
+                    const boost::filesystem::path &dir);
+
+                /**
+                 * \brief Return the entry of the file, or nullptr if the
+                 * file is not in the catalog or the entry is out of date.
+                 */
+                const PointCloudFileInfo * find(
+                    const boost::filesystem::path &file) const;
+
+                /**
+                 * \brief Scan the file if its entry is missing or out of
+                 * date and return the up to date entry.
+                 */
+                const PointCloudFileInfo & update(
+                    const boost::filesystem::path &file);
+
+                bool is_modified() const { return modified_; }
+
+                void load();
+                void save();
+
+            private:
+                boost::filesystem::path dir_;
+                std::map<std::string, PointCloudFileInfo> entries_;
+                bool modified_;
+
+                bool is_up_to_date(
+                    const PointCloudFileInfo &,
+                    const boost::filesystem::path &file) const;
+        };
+
+    }
+
+}
+
+#endif
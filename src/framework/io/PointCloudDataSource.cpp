@@ -8,18 +8,33 @@
 #include <chrono>
 #include <iomanip>
 #include <memory>
+#include <thread>
+#include <algorithm>
+#include <mutex>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <limits>
 
 #include <boost/filesystem.hpp>
 #include <boost/algorithm/string.hpp>
 #include <boost/regex.hpp>
 #include <lasreader.hpp>
 #include <lasfilter.hpp>
+#include <lasindex.hpp>
+#include <lasquadtree.hpp>
+#include <laszip_decompress_selective_v3.hpp>
 
 
 #include "framework/ReferenceSystem.h"
 #include "framework/Area.h"
-#include "framework/utils/ProgressIndicator.h"
 #include "BoundingBox.h"
+#include "PointBatchFilter.h"
+#include "PointBlock.h"
+#include "MappedLasFile.h"
+#include "PointBlockReader.h"
+#include "PointCache.h"
+#include "PointPipeline.h"
 
 namespace io {
 
@@ -59,7 +74,8 @@ namespace io {
         }
 
         std::unique_ptr<PointCloudDataSource> create_data_source(
-            const std::string & s)
+            const std::string & s,
+            bool update_catalog)
         {
             boost::regex exp1 {"([^\\.])(\\*)"};
             std::ostringstream t(std::ios::out | std::ios::binary);
@@ -76,6 +92,7 @@ namespace io {
             } else {
                 add_data_source(*data_source, s2);
             }
+            data_source->load_catalog(update_catalog);
             return data_source;
         }
 
@@ -131,6 +148,27 @@ namespace io {
             return p.classification;
         }
 
+        /**
+         * \brief Read the points of the LAZ file to the sink. The
+         * quantization of the file is stored to \a quantization if it is
+         * not null.
+         */
+        template<typename Sink>
+        size_t read_data_laz_(
+            const std::string &filename,
+            Sink &sink,
+            const std::vector<FilterParams> &filter_params,
+            bool verbose,
+            Quantization *quantization = nullptr);
+
+        template<typename Sink>
+        size_t read_data_las_(
+            const std::string &filename,
+            Sink &sink,
+            const std::vector<FilterParams> &filter_params,
+            bool verbose,
+            Quantization *quantization = nullptr);
+
         size_t read_data(
             const std::string &filename,
             Interpolator &ip,
@@ -138,6 +176,22 @@ namespace io {
         {
             if (boost::algorithm::ends_with(filename, ".laz")) {
                 return read_data_laz(filename, ip, filter_params);
+            } else if (boost::algorithm::ends_with(filename, ".las")) {
+                return read_data_las(filename, ip, filter_params);
+            } else {
+                throw std::runtime_error("Unknown point cloud format.");
+            }
+        }
+
+        size_t read_data(
+            const std::string &filename,
+            PointBuffer &buffer,
+            const std::vector<FilterParams> &filter_params)
+        {
+            if (boost::algorithm::ends_with(filename, ".laz")) {
+                return read_data_laz(filename, buffer, filter_params);
+            } else if (boost::algorithm::ends_with(filename, ".las")) {
+                return read_data_las(filename, buffer, filter_params);
             } else {
                 throw std::runtime_error("Unknown point cloud format.");
             }
@@ -148,66 +202,754 @@ namespace io {
             Interpolator &ip,
             const std::vector<FilterParams> &filter_params)
         {
-            size_t n_added {0};
-            LASreadOpener lro;
-            lro.set_file_name(filename.c_str());
-            std::unique_ptr<LASreader> reader {lro.open()};
-            geo::BoundingBox bb;
-            bb.add({reader->get_min_x(), reader->get_min_y()});
-            bb.add({reader->get_max_x(), reader->get_max_y()});
+            return read_data_laz_(filename, ip, filter_params, true);
+        }
+
+        size_t read_data_laz(
+            const std::string &filename,
+            PointBuffer &buffer,
+            const std::vector<FilterParams> &filter_params)
+        {
+            // The buffers are filled by the worker threads, so leave the
+            // printing to the caller.
+            return read_data_laz_(filename, buffer, filter_params, false);
+        }
+
+        size_t read_data_las(
+            const std::string &filename,
+            Interpolator &ip,
+            const std::vector<FilterParams> &filter_params)
+        {
+            return read_data_las_(filename, ip, filter_params, true);
+        }
 
-            std::vector<std::unique_ptr<PointFilter<LASpoint>>> filters;
+        size_t read_data_las(
+            const std::string &filename,
+            PointBuffer &buffer,
+            const std::vector<FilterParams> &filter_params)
+        {
+            return read_data_las_(filename, buffer, filter_params, false);
+        }
+
+        template<typename Sink>
+        size_t read_data_las_(
+            const std::string &filename,
+            Sink &sink,
+            const std::vector<FilterParams> &filter_params,
+            bool verbose,
+            Quantization *quantization)
+        {
+            MappedLasFile las {filename};
+            if (quantization) *quantization = las.quantization();
+            geo::BoundingBox bb;
+            bb.add({las.min_x(), las.min_y()});
+            bb.add({las.max_x(), las.max_y()});
             for (const auto &par: filter_params)
             {
-                std::unique_ptr<PointFilter<LASpoint>> filter =
-                    promote_filter<LASpoint>(par);
-                if (filter) {
-                    if (par.first == PointFilterType::KEEP_WINDOW)
+                if (par.first == PointFilterType::KEEP_WINDOW)
+                {
+                    PointFilterKeepWindow<LASpoint> f {par.second};
+                    if (!bb.overlaps_with(f)) return 0;
+                }
+            }
+            PointBatchFilter batch_filter {filter_params, las.quantization()};
+            if (batch_filter.rejects_all()) return 0;
+
+            // The records are filtered and read in place in the mapping,
+            // one block of records at a time.
+            const Quantization &q {las.quantization()};
+            const std::uint64_t n_points {las.number_of_points()};
+            const size_t block_size {PointBlock::capacity};
+            std::vector<std::uint32_t> selected(block_size);
+            size_t n_added {0};
+            unsigned int prog {0};
+            for (std::uint64_t first = 0; first < n_points; first += block_size)
+            {
+                size_t n {static_cast<size_t>(
+                    std::min<std::uint64_t>(block_size, n_points - first))};
+                const char *records {las.record(first)};
+                size_t n_selected {batch_filter.apply_records(
+                    records, las.record_length(), n,
+                    las.class_offset(), las.class_bits(), selected.data())};
+                for (size_t k = 0; k < n_selected; ++k) {
+                    const char *rec {records + selected[k] * las.record_length()};
+                    sink.insert_point(
+                        geo::GeoCoordinate {
+                            q.x(MappedLasFile::X(rec)),
+                            q.y(MappedLasFile::Y(rec))},
+                        q.z(MappedLasFile::Z(rec)));
+                }
+                n_added += n_selected;
+                if (verbose && ((first + n) * 10) / n_points > prog) {
+                    std::cout << (++prog * 10) << " %" << std::endl;
+                }
+            }
+            if (verbose) {
+                std::cout << "Added " << n_added << " points to the TIN."
+                    << std::endl;
+            }
+            return n_added;
+        }
+
+        template<typename Sink>
+        size_t read_data_laz_(
+            const std::string &filename,
+            Sink &sink,
+            const std::vector<FilterParams> &filter_params,
+            bool verbose,
+            Quantization *quantization)
+        {
+            PointBlockReader reader {filename, filter_params};
+            if (quantization) *quantization = reader.quantization();
+            if (!reader.overlaps()) return 0;
+            if (verbose && reader.uses_index()) {
+                std::cout << "  Using the spatial index '"
+                    << lax_filename(filename) << "'." << std::endl;
+            }
+            PointBatchFilter batch_filter {filter_params, reader.quantization()};
+            if (batch_filter.rejects_all()) return 0;
+
+            PointBlock block;
+            std::vector<std::uint32_t> selected(PointBlock::capacity);
+            const std::uint64_t n_points {reader.number_of_points()};
+            std::uint64_t n_read {0};
+            size_t n_added {0};
+            unsigned int prog {0};
+            while (reader.read(block))
+            {
+                size_t n {batch_filter.apply(block, selected.data())};
+                for (size_t k = 0; k < n; ++k) {
+                    size_t i {selected[k]};
+                    sink.insert_point(
+                        geo::GeoCoordinate {block.x(i), block.y(i)},
+                        block.z(i));
+                }
+                n_added += n;
+                n_read += block.size;
+                // With a spatial index only a part of the points is read,
+                // so the progress may stop short of 100 %.
+                if (verbose && (n_read * 10) / n_points > prog) {
+                    prog = static_cast<unsigned int>((n_read * 10) / n_points);
+                    std::cout << (prog * 10) << " %" << std::endl;
+                }
+            }
+            if (verbose) {
+                std::cout << "Added " << n_added << " points to the TIN."
+                    << std::endl;
+            }
+            return n_added;
+        }
+
+        template<typename Sink>
+        size_t read_data_cached_(
+            const std::string &filename,
+            Sink &sink,
+            const std::vector<FilterParams> &filter_params,
+            const PointCache &cache,
+            bool verbose)
+        {
+            std::unique_ptr<CachedPoints> cached {
+                cache.open(filename, filter_params)};
+            size_t n_added {0};
+            if (cached) {
+                if (verbose) {
+                    std::cout << "  Using the cached points." << std::endl;
+                }
+                cached->insert_to(sink);
+                n_added = static_cast<size_t>(cached->size());
+            } else {
+                // The points are cached in the integer space of the file.
+                PointBuffer buffer;
+                Quantization q;
+                if (boost::algorithm::ends_with(filename, ".laz")) {
+                    read_data_laz_(filename, buffer, filter_params, false, &q);
+                } else if (boost::algorithm::ends_with(filename, ".las")) {
+                    read_data_las_(filename, buffer, filter_params, false, &q);
+                } else {
+                    throw std::runtime_error("Unknown point cloud format.");
+                }
+                cache.save(filename, filter_params, buffer, q);
+                for (size_t i = 0; i < buffer.size(); ++i) {
+                    sink.insert_point(
+                        geo::GeoCoordinate {buffer.x(i), buffer.y(i)},
+                        buffer.z(i));
+                }
+                n_added = buffer.size();
+            }
+            if (verbose && n_added > 0) {
+                std::cout << "Added " << n_added << " points to the TIN."
+                    << std::endl;
+            }
+            return n_added;
+        }
+
+        /**
+         * \brief Read the points of the file from the cache if there is
+         * one, otherwise from the file itself.
+         */
+        template<typename Sink>
+        size_t read_file_(
+            const std::string &filename,
+            Sink &sink,
+            const std::vector<FilterParams> &filter_params,
+            const PointCache *cache,
+            bool verbose)
+        {
+            if (cache) {
+                return read_data_cached_(
+                    filename, sink, filter_params, *cache, verbose);
+            }
+            return read_data(filename, sink, filter_params);
+        }
+
+        template<typename Sink>
+        size_t read_points_serial(
+            const std::vector<boost::filesystem::path> &filenames,
+            const std::vector<FilterParams> &filter_params,
+            Sink &ip,
+            const PointCache *cache)
+        {
+            size_t n_total {0};
+            for (const auto &f: filenames) {
+                std::cout << "Importing points from the file '"
+                    << f.string() << "'" << std::endl;
+                size_t n {read_file_(f.string(), ip, filter_params, cache, true)};
+                if (n == static_cast<size_t>(0)) {
+                    std::cout <<"  No matching points." << std::endl;
+                }
+                n_total += n;
+            }
+            return n_total;
+        }
+
+        /**
+         * \brief Read the files to buffers in n_threads threads and pass
+         * the buffers to \a consume with the indexes of the files in the
+         * order of the files.
+         */
+        template<typename Consume>
+        size_t read_buffers_parallel(
+            const std::vector<boost::filesystem::path> &filenames,
+            const std::vector<FilterParams> &filter_params,
+            unsigned int n_threads,
+            const PointCache *cache,
+            Consume consume)
+        {
+            const size_t n_files {filenames.size()};
+            std::vector<PointBuffer> buffers(n_files);
+            std::vector<std::exception_ptr> errors(n_files);
+            std::vector<bool> done(n_files, false);
+            std::mutex m;
+            std::condition_variable cv;
+            size_t next_file {0};
+            size_t n_merged {0};
+            bool stop {false};
+
+            // The workers may read ahead at most a couple of files per
+            // thread so that the unmerged buffers do not pile up in memory.
+            const size_t max_ahead {2 * static_cast<size_t>(n_threads)};
+
+            auto worker = [&]() {
+                for (;;) {
+                    size_t i;
+                    {
+                        std::unique_lock<std::mutex> lock {m};
+                        cv.wait(lock, [&]() {
+                            return stop || next_file >= n_files ||
+                                next_file < n_merged + max_ahead;
+                        });
+                        if (stop || next_file >= n_files) return;
+                        i = next_file++;
+                    }
+                    try {
+                        read_file_(filenames[i].string(), buffers[i],
+                            filter_params, cache, false);
+                    } catch (...) {
+                        errors[i] = std::current_exception();
+                    }
                     {
-                        PointFilterKeepWindow<LASpoint> &f =
-                            dynamic_cast<PointFilterKeepWindow<LASpoint>&>(*filter);
-                        if (!bb.overlaps_with(f)) return 0;
+                        std::lock_guard<std::mutex> lock {m};
+                        done[i] = true;
                     }
-                    filters.push_back(std::move(filter));
+                    cv.notify_all();
                 }
+            };
+
+            std::vector<std::thread> threads;
+            for (unsigned int t = 0; t < n_threads; ++t) {
+                threads.emplace_back(worker);
             }
 
-            utils::ProgressIndicator indic {reader->npoints, 10};
-            while (reader->read_point())
-            {
-                LASpoint &point = reader->point;
-                geo::GeoCoordinate gp {point.get_x(), point.get_y()};
-                bool print_progress {indic.inc()};
-                bool add {true};
-                for (const auto &f: filters)
+            // Pass the buffers in the order of the files so that the
+            // triangulation is the same as with the serial reading.
+            size_t n_total {0};
+            std::exception_ptr error;
+            for (size_t i = 0; i < n_files; ++i) {
+                {
+                    std::unique_lock<std::mutex> lock {m};
+                    cv.wait(lock, [&]() { return done[i]; });
+                }
+                if (errors[i]) {
+                    error = errors[i];
+                    break;
+                }
+                try {
+                    consume(i, buffers[i]);
+                } catch (...) {
+                    error = std::current_exception();
+                    break;
+                }
+                n_total += buffers[i].size();
+                buffers[i].clear();
                 {
-                    if (!(*f)(point)) {
-                        add = false;
-                        break;
+                    std::lock_guard<std::mutex> lock {m};
+                    ++n_merged;
+                }
+                cv.notify_all();
+            }
+            {
+                std::lock_guard<std::mutex> lock {m};
+                stop = true;
+            }
+            cv.notify_all();
+            for (auto &t: threads) t.join();
+            if (error) std::rethrow_exception(error);
+            return n_total;
+        }
+
+        template<typename Sink>
+        size_t read_points_parallel(
+            const std::vector<boost::filesystem::path> &filenames,
+            const std::vector<FilterParams> &filter_params,
+            Sink &ip,
+            unsigned int n_threads,
+            const PointCache *cache)
+        {
+            return read_buffers_parallel(filenames, filter_params, n_threads, cache,
+                [&](size_t i, PointBuffer &buffer) {
+                    std::cout << "Importing points from the file '"
+                        << filenames[i].string() << "'" << std::endl;
+                    if (buffer.size() == 0) {
+                        std::cout <<"  No matching points." << std::endl;
+                        return;
+                    }
+                    buffer.insert_to(ip);
+                    std::cout << "Added " << buffer.size()
+                        << " points to the TIN." << std::endl;
+                });
+        }
+
+        size_t estimate_number_of_points(
+            const PointCloudDataSource &src,
+            const std::vector<FilterParams> &filter_params)
+        {
+            double n_total {0};
+            for (const auto &f: src.filenames(filter_params)) {
+                double n {0};
+                double min_x, max_x, min_y, max_y;
+                const PointCloudFileInfo *info {src.file_info(f)};
+                if (info) {
+                    // The catalog has the bounds and the points of each
+                    // class without opening the file.
+                    n = static_cast<double>(info->n_points);
+                    min_x = info->min_x;
+                    max_x = info->max_x;
+                    min_y = info->min_y;
+                    max_y = info->max_y;
+                    for (const auto &par: filter_params)
+                    {
+                        if (par.first != PointFilterType::KEEP_CLASSES) continue;
+                        std::uint64_t n_classes {0};
+                        for (const auto &c: par.second) {
+                            int k {boost::lexical_cast<int>(c)};
+                            if (k >= 0 && k < static_cast<int>(info->class_counts.size())) {
+                                n_classes += info->class_counts[static_cast<size_t>(k)];
+                            }
+                        }
+                        n = std::min(n, static_cast<double>(n_classes));
                     }
+                } else {
+                    LASreadOpener lro;
+                    lro.set_file_name(f.string().c_str());
+                    std::unique_ptr<LASreader> reader {lro.open()};
+                    if (!reader) continue;
+                    const LASheader &h {reader->header};
+                    n = static_cast<double>(reader->npoints);
+                    min_x = h.min_x;
+                    max_x = h.max_x;
+                    min_y = h.min_y;
+                    max_y = h.max_y;
+                    reader->close();
                 }
-                if (add)
+                double area {(max_x - min_x) * (max_y - min_y)};
+                for (const auto &par: filter_params)
                 {
-                    ip.insert_point(gp, point.get_z());
-                    ++n_added;
-                    indic.mark();
+                    if (par.first != PointFilterType::KEEP_WINDOW) continue;
+                    // Assume that the points are evenly distributed.
+                    PointFilterKeepWindow<LASpoint> w {par.second};
+                    double dx {std::min(max_x, w.right()) -
+                        std::max(min_x, w.left())};
+                    double dy {std::min(max_y, w.top()) -
+                        std::max(min_y, w.bottom())};
+                    if (dx < 0 || dy < 0) {
+                        n = 0;
+                    } else if (area > 0) {
+                        n *= std::min(1.0, dx * dy / area);
+                    }
                 }
-                if (print_progress) {
-                    std::stringstream ss;
-                    ss << indic.progress() << " %";
-                    std::cout << ss.str() << std::endl;
+                n_total += n;
+            }
+            return static_cast<size_t>(n_total);
+        }
+
+        std::vector<std::pair<boost::filesystem::path, double>> files_from_north(
+            const PointCloudDataSource &src)
+        {
+            std::vector<std::pair<boost::filesystem::path, double>> files;
+            for (const auto &f: src.filenames()) {
+                double top {std::numeric_limits<double>::infinity()};
+                const PointCloudFileInfo *info {src.file_info(f)};
+                if (info) {
+                    top = info->top();
+                } else {
+                    LASreadOpener lro;
+                    lro.set_file_name(f.string().c_str());
+                    std::unique_ptr<LASreader> reader {lro.open()};
+                    if (reader) {
+                        top = reader->header.max_y;
+                        reader->close();
+                    }
                 }
-                // For animated progress bar
-                //if (print_progress) {
-                //    std::cout << '\r' << indic.bar_str();
-                //    std::cout.flush();
-                //}
+                files.push_back({f, top});
+            }
+            std::stable_sort(files.begin(), files.end(),
+                [](const std::pair<boost::filesystem::path, double> &a,
+                   const std::pair<boost::filesystem::path, double> &b) {
+                    return a.second > b.second;
+                });
+            return files;
+        }
+
+        size_t read_data_laz_chunked(
+            const std::string &filename,
+            Interpolator &ip,
+            const std::vector<FilterParams> &filter_params,
+            unsigned int n_threads)
+        {
+            std::uint64_t n_points {0};
+            std::uint64_t chunk_size {0};
+            {
+                PointBlockReader reader {filename, filter_params};
+                if (!reader.overlaps()) return 0;
+                if (reader.uses_index()) {
+                    // The index reads only the cells near the window, which
+                    // is faster than decoding all the chunks concurrently.
+                    return read_data_laz(filename, ip, filter_params);
+                }
+                PointBatchFilter batch_filter {
+                    filter_params, reader.quantization()};
+                if (batch_filter.rejects_all()) return 0;
+                n_points = reader.number_of_points();
+                chunk_size = reader.chunk_size();
+            }
+            if (n_points == 0) return 0;
+
+            // Split the file into a few ranges per thread so that the
+            // threads stay busy even if the ranges are of different cost.
+            // The ranges start at chunk boundaries so that a seek does not
+            // need to decode the preceding points of the chunk.
+            const std::uint64_t n_parts {4 * static_cast<std::uint64_t>(n_threads)};
+            std::uint64_t range_size {(n_points + n_parts - 1) / n_parts};
+            if (chunk_size > 0) {
+                range_size = ((range_size + chunk_size - 1) / chunk_size)
+                    * chunk_size;
+            }
+            const size_t n_ranges {static_cast<size_t>(
+                (n_points + range_size - 1) / range_size)};
+            n_threads = std::min(n_threads, static_cast<unsigned int>(n_ranges));
+            std::cout << "  Decoding " << n_ranges << " parts of the file using "
+                << n_threads << " threads." << std::endl;
+
+            std::vector<PointBuffer> buffers(n_ranges);
+            std::vector<std::exception_ptr> errors(n_ranges);
+            std::mutex m;
+            size_t next_range {0};
+
+            auto worker = [&]() {
+                std::unique_ptr<PointBlockReader> reader;
+                std::unique_ptr<PointBatchFilter> batch_filter;
+                PointBlock block;
+                std::vector<std::uint32_t> selected(PointBlock::capacity);
+                for (;;) {
+                    size_t i;
+                    {
+                        std::lock_guard<std::mutex> lock {m};
+                        if (next_range >= n_ranges) return;
+                        i = next_range++;
+                    }
+                    try {
+                        if (!reader) {
+                            reader.reset(
+                                new PointBlockReader(filename, filter_params));
+                            batch_filter.reset(new PointBatchFilter(
+                                filter_params, reader->quantization()));
+                        }
+                        reader->restrict_to(i * range_size, range_size);
+                        while (reader->read(block))
+                        {
+                            size_t n {batch_filter->apply(block, selected.data())};
+                            for (size_t k = 0; k < n; ++k) {
+                                size_t j {selected[k]};
+                                buffers[i].insert_point(
+                                    geo::GeoCoordinate {block.x(j), block.y(j)},
+                                    block.z(j));
+                            }
+                        }
+                    } catch (...) {
+                        errors[i] = std::current_exception();
+                        // A reader in an unknown state is not reused.
+                        reader.reset();
+                    }
+                }
+            };
+
+            std::vector<std::thread> threads;
+            for (unsigned int t = 0; t < n_threads; ++t) {
+                threads.emplace_back(worker);
+            }
+            for (auto &t: threads) t.join();
+            for (const auto &e: errors) {
+                if (e) std::rethrow_exception(e);
+            }
+
+            // Concatenate the ranges in the order of the file, so the
+            // triangulation is the same as with the sequential reading.
+            size_t n_added {0};
+            for (auto &buffer: buffers) {
+                buffer.insert_to(ip);
+                n_added += buffer.size();
+                buffer.clear();
             }
             std::cout << "Added " << n_added << " points to the TIN."
                 << std::endl;
             return n_added;
         }
 
+        size_t read_points_split(
+            const std::vector<boost::filesystem::path> &filenames,
+            const std::vector<FilterParams> &filter_params,
+            Interpolator &ip,
+            unsigned int n_threads)
+        {
+            size_t n_total {0};
+            for (const auto &f: filenames) {
+                std::cout << "Importing points from the file '"
+                    << f.string() << "'" << std::endl;
+                size_t n {0};
+                if (boost::ends_with(f.string(), ".laz")) {
+                    n = read_data_laz_chunked(
+                        f.string(), ip, filter_params, n_threads);
+                } else {
+                    n = read_data(f.string(), ip, filter_params);
+                }
+                if (n == static_cast<size_t>(0)) {
+                    std::cout <<"  No matching points." << std::endl;
+                }
+                n_total += n;
+            }
+            return n_total;
+        }
+
+        size_t read_points(
+            const PointCloudDataSource &src,
+            const std::vector<FilterParams> &filter_params,
+            Interpolator &ip,
+            const ProcessingOptions &options)
+        {
+            std::vector<boost::filesystem::path> filenames {
+                src.filenames(filter_params)};
+            std::unique_ptr<PointCache> cache;
+            if (!options.cache_dir.empty()) {
+                if (options.pipelined || options.split_files) {
+                    std::cout << "The point cache is not used when reading "
+                        "in a pipeline or splitting the files." << std::endl;
+                } else {
+                    cache.reset(new PointCache(options.cache_dir));
+                }
+            }
+            if (options.pipelined) {
+                std::cout << "Reading " << filenames.size()
+                    << " files in a pipeline." << std::endl;
+                return read_points_pipelined(filenames, filter_params, ip);
+            }
+            unsigned int n_threads {options.n_threads};
+            if (options.split_files && n_threads > 1) {
+                return read_points_split(
+                    filenames, filter_params, ip, n_threads);
+            }
+            if (n_threads <= 1 || filenames.size() <= 1) {
+                return read_points_serial(
+                    filenames, filter_params, ip, cache.get());
+            }
+            n_threads = std::min(n_threads,
+                static_cast<unsigned int>(filenames.size()));
+            std::cout << "Reading " << filenames.size() << " files using "
+                << n_threads << " threads." << std::endl;
+            return read_points_parallel(
+                filenames, filter_params, ip, n_threads, cache.get());
+        }
+
+        size_t read_points(
+            const PointCloudDataSource &src,
+            const std::vector<FilterParams> &filter_params,
+            PointBuffer &buffer,
+            const ProcessingOptions &options)
+        {
+            std::vector<boost::filesystem::path> filenames {
+                src.filenames(filter_params)};
+            if (options.pipelined || options.split_files) {
+                std::cout << "The points are read to buffers without a "
+                    "pipeline or splitting the files." << std::endl;
+            }
+            std::unique_ptr<PointCache> cache;
+            if (!options.cache_dir.empty()) {
+                cache.reset(new PointCache(options.cache_dir));
+            }
+            unsigned int n_threads {options.n_threads};
+            if (n_threads <= 1 || filenames.size() <= 1) {
+                return read_points_serial(
+                    filenames, filter_params, buffer, cache.get());
+            }
+            n_threads = std::min(n_threads,
+                static_cast<unsigned int>(filenames.size()));
+            std::cout << "Reading " << filenames.size() << " files using "
+                << n_threads << " threads." << std::endl;
+            return read_points_parallel(
+                filenames, filter_params, buffer, n_threads, cache.get());
+        }
+
+        size_t read_files(
+            const std::vector<boost::filesystem::path> &filenames,
+            const std::vector<FilterParams> &filter_params,
+            const ProcessingOptions &options,
+            const std::function<void(size_t, const PointBuffer &)> &consume)
+        {
+            if (options.pipelined || options.split_files) {
+                std::cout << "The files are read one at a time without a "
+                    "pipeline or splitting the files." << std::endl;
+            }
+            std::unique_ptr<PointCache> cache;
+            if (!options.cache_dir.empty()) {
+                cache.reset(new PointCache(options.cache_dir));
+            }
+            unsigned int n_threads {std::min(options.n_threads,
+                static_cast<unsigned int>(filenames.size()))};
+            if (n_threads > 1) {
+                std::cout << "Reading " << filenames.size() << " files using "
+                    << n_threads << " threads." << std::endl;
+                return read_buffers_parallel(
+                    filenames, filter_params, n_threads, cache.get(),
+                    [&](size_t i, PointBuffer &buffer) {
+                        std::cout << "Importing points from the file '"
+                            << filenames[i].string() << "'" << std::endl;
+                        consume(i, buffer);
+                    });
+            }
+            size_t n_total {0};
+            PointBuffer buffer;
+            for (size_t i = 0; i < filenames.size(); ++i) {
+                std::cout << "Importing points from the file '"
+                    << filenames[i].string() << "'" << std::endl;
+                buffer.reset();
+                n_total += read_file_(filenames[i].string(), buffer,
+                    filter_params, cache.get(), false);
+                consume(i, buffer);
+            }
+            return n_total;
+        }
+
+        void report_pixels_outside(size_t n_outside)
+        {
+            if (n_outside > 0) {
+                std::cout << "Left " << n_outside << " pixels outside of the "
+                    << "TIN as no data." << std::endl;
+            }
+        }
+
+        std::string lax_filename(const std::string &filename)
+        {
+            boost::filesystem::path p {filename};
+            p.replace_extension(".lax");
+            return p.string();
+        }
+
+        bool has_lax_index(const std::string &filename)
+        {
+            return boost::filesystem::exists(lax_filename(filename));
+        }
+
+        void create_lax_index(const std::string &filename)
+        {
+            LASreadOpener lro;
+            lro.set_file_name(filename.c_str());
+            // The index needs only the x and y coordinates.
+            lro.set_decompress_selective(
+                LASZIP_DECOMPRESS_SELECTIVE_CHANNEL_RETURNS_XY);
+            std::unique_ptr<LASreader> reader {lro.open()};
+            if (!reader) {
+                std::stringstream ss;
+                ss << "Failed to open the file '" << filename
+                    << "' for indexing.";
+                throw std::runtime_error(ss.str());
+            }
+
+            // Choose the quadtree cell size from the point density the
+            // same way the lasindex tool does.
+            const LASheader &h {reader->header};
+            double area {(h.max_x - h.min_x) * (h.max_y - h.min_y)};
+            double density {area > 0 ? reader->npoints / area : 0.0};
+            float cell_size {100000.0f};
+            if (density >= 10.0) cell_size = 10.0f;
+            else if (density >= 1.0) cell_size = 100.0f;
+            else if (density >= 0.1) cell_size = 1000.0f;
+            else if (density >= 0.01) cell_size = 10000.0f;
+
+            // LASindex takes the ownership of the quadtree.
+            LASquadtree *quadtree {new LASquadtree};
+            quadtree->setup(h.min_x, h.max_x, h.min_y, h.max_y, cell_size);
+            LASindex index;
+            index.prepare(quadtree, 1000);
+            while (reader->read_point())
+            {
+                index.add(reader->point.get_x(), reader->point.get_y(),
+                    static_cast<U32>(reader->p_count - 1));
+            }
+            reader->close();
+            index.complete(100000, -20, FALSE);
+            if (!index.write(lax_filename(filename).c_str())) {
+                std::stringstream ss;
+                ss << "Failed to write the spatial index '"
+                    << lax_filename(filename) << "'.";
+                throw std::runtime_error(ss.str());
+            }
+        }
+
+        size_t create_missing_lax_indexes(const PointCloudDataSource &src)
+        {
+            size_t n_created {0};
+            for (const auto &f: src.filenames()) {
+                // The .las files are read through a memory mapping which
+                // does not use the index.
+                if (!boost::ends_with(f.string(), ".laz")) continue;
+                if (has_lax_index(f.string())) continue;
+                std::cout << "Creating the spatial index for the file '"
+                    << f.string() << "'" << std::endl;
+                create_lax_index(f.string());
+                ++n_created;
+            }
+            return n_created;
+        }
+
         PointCloudDataSource::PointCloudDataSource()
         {
         }
@@ -243,7 +985,8 @@ namespace io {
             {
                 if (boost::filesystem::is_regular_file(f) ||
                     boost::filesystem::is_symlink(f)) {
-                    if (boost::ends_with(f.string(), ".laz")) {
+                    if (boost::ends_with(f.string(), ".laz") ||
+                        boost::ends_with(f.string(), ".las")) {
                         filenames_.push_back(f);
                     } else {
                         std::stringstream ss;
@@ -266,13 +1009,122 @@ namespace io {
             return filter_params_;
         }
 
+        void PointCloudDataSource::load_catalog(bool update)
+        {
+            std::map<boost::filesystem::path,
+                std::unique_ptr<PointCloudCatalog>> catalogs;
+            file_info_.clear();
+            file_index_.clear();
+            file_numbers_.clear();
+            size_t n_known {0};
+            for (size_t i = 0; i < filenames_.size(); ++i) {
+                const boost::filesystem::path &f {filenames_[i]};
+                file_numbers_.emplace(f.string(), i);
+                boost::filesystem::path dir {
+                    boost::filesystem::absolute(f).parent_path()};
+                auto &catalog = catalogs[dir];
+                if (!catalog) {
+                    catalog.reset(new PointCloudCatalog(dir));
+                    catalog->load();
+                }
+                const PointCloudFileInfo *info {
+                    update ? &catalog->update(f) : catalog->find(f)};
+                if (info) {
+                    file_info_.emplace_back(new PointCloudFileInfo(*info));
+                    file_index_.insert(std::make_pair(
+                        Box {BoxPoint {info->min_x, info->min_y},
+                             BoxPoint {info->max_x, info->max_y}},
+                        i));
+                    ++n_known;
+                } else {
+                    file_info_.emplace_back(nullptr);
+                }
+            }
+            for (auto &c: catalogs) {
+                if (c.second->is_modified()) c.second->save();
+            }
+            if (n_known > 0) {
+                std::cout << "Found " << n_known << " of "
+                    << filenames_.size() << " files in the catalogs."
+                    << std::endl;
+            }
+        }
+
+        std::vector<bool> PointCloudDataSource::files_overlapping(
+            const Box &box) const
+        {
+            // The files without a catalog entry may overlap with anything.
+            std::vector<bool> overlaps(filenames_.size());
+            for (size_t i = 0; i < filenames_.size(); ++i) {
+                overlaps[i] = !file_info_[i];
+            }
+            std::vector<std::pair<Box, size_t>> hits;
+            file_index_.query(
+                boost::geometry::index::intersects(box),
+                std::back_inserter(hits));
+            for (const auto &h: hits) {
+                overlaps[h.second] = true;
+            }
+            return overlaps;
+        }
+
         std::vector<boost::filesystem::path> PointCloudDataSource::filenames() const
         {
-            return filenames_;
+            return filenames(filter_params_);
+        }
+
+        std::vector<boost::filesystem::path> PointCloudDataSource::filenames(
+            const std::vector<FilterParams> &filter_params) const
+        {
+            std::vector<bool> keep(filenames_.size(), true);
+            for (const auto &par: filter_params)
+            {
+                if (par.first == PointFilterType::KEEP_WINDOW) {
+                    PointFilterKeepWindow<LASpoint> w {par.second};
+                    std::vector<bool> overlaps {files_overlapping(
+                        Box {BoxPoint {w.left(), w.bottom()},
+                             BoxPoint {w.right(), w.top()}})};
+                    for (size_t i = 0; i < keep.size(); ++i) {
+                        keep[i] = keep[i] && overlaps[i];
+                    }
+                } else if (par.first == PointFilterType::KEEP_CLASSES) {
+                    for (size_t i = 0; i < keep.size(); ++i) {
+                        if (!keep[i] || !file_info_[i]) continue;
+                        bool has_any {false};
+                        for (const auto &c: par.second) {
+                            if (file_info_[i]->has_class(
+                                    boost::lexical_cast<int>(c))) {
+                                has_any = true;
+                                break;
+                            }
+                        }
+                        keep[i] = has_any;
+                    }
+                }
+            }
+            std::vector<boost::filesystem::path> ret;
+            for (size_t i = 0; i < filenames_.size(); ++i) {
+                if (keep[i]) ret.push_back(filenames_[i]);
+            }
+            return ret;
+        }
+
+        const PointCloudFileInfo * PointCloudDataSource::file_info(
+            const boost::filesystem::path &file) const
+        {
+            auto it = file_numbers_.find(file.string());
+            if (it == file_numbers_.end()) return nullptr;
+            return file_info_[it->second].get();
         }
 
         geo::ReferenceSystem PointCloudDataSource::CRS() const {
-            std::cout << "PointCloudDataSource::CRS() not impl." << std::endl;
+            for (const auto &info: file_info_) {
+                if (info && info->crs.size() > 0) {
+                    return geo::ReferenceSystem {info->crs};
+                }
+            }
+            std::cout << "PointCloudDataSource::CRS(): no reference system "
+                "found in the catalogs." << std::endl;
             return {};
         }
 
@@ -297,17 +1149,32 @@ namespace io {
             return "";
         }
 
-        bool PointCloudDataSource::has_data_inside_area(const geo::Area &) const
+        bool PointCloudDataSource::has_data_inside_area(const geo::Area &a) const
         {
-            std::cout << "PointCloudDataSource::has_data_inside_area() not impl."
-                << std::endl;
-            return true;
+            std::vector<bool> overlaps {files_overlapping(
+                Box {BoxPoint {a.left(), a.bottom()},
+                     BoxPoint {a.right(), a.top()}})};
+            return std::find(overlaps.begin(), overlaps.end(), true) !=
+                overlaps.end();
         }
 
         geo::Area PointCloudDataSource::area() const
         {
-            std::cout << "PointCloudDataSource::area() not impl." << std::endl;
-            return {};
+            if (file_index_.empty()) {
+                std::cout << "PointCloudDataSource::area(): no files found "
+                    "in the catalogs." << std::endl;
+                return {};
+            }
+            namespace bg = boost::geometry;
+            auto b = file_index_.bounds();
+            double xmin {bg::get<bg::min_corner, 0>(b)};
+            double ymin {bg::get<bg::min_corner, 1>(b)};
+            double xmax {bg::get<bg::max_corner, 0>(b)};
+            double ymax {bg::get<bg::max_corner, 1>(b)};
+            return geo::Area {
+                geo::GeoCoordinate {xmin, ymax},
+                geo::GeoDims {xmax - xmin, ymax - ymin},
+                CRS()};
         }
 
     }
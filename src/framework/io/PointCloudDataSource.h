@@ -1,16 +1,29 @@
 #ifndef POINT_CLOUD_H_
 #define POINT_CLOUD_H_
 
+#include <algorithm>
+#include <cmath>
+#include <exception>
+#include <functional>
+#include <limits>
 #include <map>
 #include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
 
 #include <boost/lexical_cast.hpp>
 #include <boost/filesystem.hpp>
+#include <boost/geometry/geometries/box.hpp>
+#include <boost/geometry/geometries/point_xy.hpp>
+#include <boost/geometry/index/rtree.hpp>
 
 #include "framework/ReferenceSystem.h"
 #include "framework/RasterArea.h"
 #include "framework/coordinates.h"
 #include "framework/io/Interpolator.h"
+#include "framework/io/PointBuffer.h"
+#include "framework/io/PointCloudCatalog.h"
 #include "framework/utils/string_utils.h"
 
 class LASpoint;
@@ -21,8 +34,16 @@ namespace io {
 
         class PointCloudDataSource;
 
+        /**
+         * \brief Create a data source from the files matching the string.
+         *
+         * The summaries of the files are read from the catalogs of their
+         * directories. With \a update_catalog the missing and out of date
+         * catalog entries are created by scanning the files.
+         */
         std::unique_ptr<PointCloudDataSource> create_data_source(
-            const std::string & s);
+            const std::string & s,
+            bool update_catalog = false);
 
         enum class PointFilterType {KEEP_WINDOW, KEEP_CLASSES};
 
@@ -38,6 +59,186 @@ namespace io {
             Interpolator &ip,
             const std::vector<FilterParams> &filter_params);
 
+        size_t read_data_las(
+            const std::string &filename,
+            Interpolator &ip,
+            const std::vector<FilterParams> &filter_params);
+
+        size_t read_data(
+            const std::string &filename,
+            PointBuffer &buffer,
+            const std::vector<FilterParams> &filter_params);
+
+        size_t read_data_laz(
+            const std::string &filename,
+            PointBuffer &buffer,
+            const std::vector<FilterParams> &filter_params);
+
+        size_t read_data_las(
+            const std::string &filename,
+            PointBuffer &buffer,
+            const std::vector<FilterParams> &filter_params);
+
+        /**
+         * \brief Options for reading the points and interpolating them.
+         */
+        class ProcessingOptions
+        {
+            public:
+                ProcessingOptions():
+                    n_threads {1},
+                    pipelined {false},
+                    split_files {false},
+                    thinning {ThinningPolicy::NONE},
+                    thinning_cell_size {0},
+                    bulk_tin {true},
+                    parallel_tin {false},
+                    interpolation {InterpolationMethod::NATURAL_NEIGHBOR},
+                    tile_size {0},
+                    tile_halo {0},
+                    stream_rows {0}
+                {
+                }
+
+                /// Number of threads used for reading the files and for
+                /// interpolating the raster.
+                unsigned int n_threads;
+                /// Decode, filter and triangulate in separate threads.
+                bool pipelined;
+                /// Decode the chunks of each LAZ file in n_threads threads.
+                bool split_files;
+                /// Directory of the filtered point cache, empty if not used.
+                std::string cache_dir;
+                /// The point kept from each cell of the thinning grid.
+                ThinningPolicy thinning;
+                /// Thinning grid cell size, 0 collapses only duplicates.
+                double thinning_cell_size;
+                /// Build the TIN from all the points at once after reading.
+                bool bulk_tin;
+                /// Build the bulk TIN in n_threads threads.
+                bool parallel_tin;
+                InterpolationMethod interpolation;
+                /// Width and height of the tiles in pixels, 0 for one TIN.
+                unsigned int tile_size;
+                /// The points this far outside of a tile are included in
+                /// the TIN of the tile.
+                double tile_halo;
+                /// Height of the bands of rows of the streaming mode in
+                /// pixels, 0 to read all the points before triangulating.
+                unsigned int stream_rows;
+        };
+
+        /**
+         * \brief Read the points from all the files of the data source to
+         * the interpolator.
+         *
+         * With n_threads > 1 the files are decoded and filtered
+         * concurrently into separate buffers, but the buffers are inserted
+         * to the interpolator in the order of the files, so the result is
+         * identical to the one read with a single thread. With the
+         * pipelined option the decoding, filtering and triangulation run
+         * in separate threads. With the split_files option the files are
+         * read one at a time but the chunks of each LAZ file are decoded
+         * concurrently. With a cache_dir the filtered points of each file
+         * are stored to the cache and read from there on the next run.
+         */
+        size_t read_points(
+            const PointCloudDataSource &src,
+            const std::vector<FilterParams> &filter_params,
+            Interpolator &ip,
+            const ProcessingOptions &options);
+
+        /**
+         * \brief Read the points from the files of the data source that
+         * may pass the filters to the buffer in the order of the files.
+         *
+         * The files are read in n_threads threads and through the cache as
+         * with the interpolator, but the pipelined and split_files options
+         * are not used.
+         */
+        size_t read_points(
+            const PointCloudDataSource &src,
+            const std::vector<FilterParams> &filter_params,
+            PointBuffer &buffer,
+            const ProcessingOptions &options);
+
+        /**
+         * \brief Read the points of the files to a buffer per file and pass
+         * the buffers to \a consume with the indexes of the files in the
+         * given order.
+         *
+         * With n_threads > 1 the next files are read concurrently while a
+         * buffer is consumed. The files are read through the cache as by
+         * read_points(), but the pipelined and split_files options are not
+         * used.
+         */
+        size_t read_files(
+            const std::vector<boost::filesystem::path> &filenames,
+            const std::vector<FilterParams> &filter_params,
+            const ProcessingOptions &options,
+            const std::function<void(size_t, const PointBuffer &)> &consume);
+
+        /**
+         * \brief Estimate the number of points inside the window from the
+         * point counts and the bounds of the files.
+         *
+         * The counts of the requested classes and the bounds are taken
+         * from the catalog, and only the files that are not in it are
+         * opened for their headers, as in files_from_north().
+         */
+        size_t estimate_number_of_points(
+            const PointCloudDataSource &src,
+            const std::vector<FilterParams> &filter_params);
+
+        /**
+         * \brief Read the points of a single LAZ file decoding its chunks
+         * concurrently in n_threads threads.
+         *
+         * Each thread has its own reader which is positioned at the start
+         * of a range of whole chunks. The filtered points of the ranges
+         * are inserted to the interpolator in the order of the file.
+         */
+        size_t read_data_laz_chunked(
+            const std::string &filename,
+            Interpolator &ip,
+            const std::vector<FilterParams> &filter_params,
+            unsigned int n_threads);
+
+        /**
+         * \brief Return the files of the data source with the maximum y
+         * of each, sorted from north to south.
+         *
+         * The bounds are taken from the catalog or else from the header of
+         * the file. The files whose bounds are not known are first with an
+         * infinite maximum y.
+         */
+        std::vector<std::pair<boost::filesystem::path, double>> files_from_north(
+            const PointCloudDataSource &src);
+
+        /**
+         * \brief Print the number of the pixels left as no data because
+         * they are outside of the TIN, if there are any.
+         */
+        void report_pixels_outside(size_t n_outside);
+
+        /**
+         * \brief Return the name of the .lax spatial index that LASlib
+         * looks for next to the given point cloud file.
+         */
+        std::string lax_filename(const std::string &filename);
+        bool has_lax_index(const std::string &filename);
+
+        /**
+         * \brief Build a .lax spatial index for the given file.
+         */
+        void create_lax_index(const std::string &filename);
+
+        /**
+         * \brief Build the .lax indexes for the files of the data source
+         * that do not have one yet. Return the number of indexes created.
+         */
+        size_t create_missing_lax_indexes(const PointCloudDataSource &src);
+
 
         class PointCloudDataSource
         {
@@ -51,6 +252,14 @@ namespace io {
                     const std::string &filter_name,
                     const std::string &filter_str);
 
+                /**
+                 * \brief Read the file summaries from the catalogs of the
+                 * directories of the files. With \a update the files with
+                 * missing or out of date entries are scanned and the
+                 * catalogs are saved.
+                 */
+                void load_catalog(bool update);
+
                 geo::ReferenceSystem CRS() const;
                 bool has_no_data_value() const;
                 double no_data_value() const;
@@ -59,21 +268,529 @@ namespace io {
                 geo::Area area() const;
 
                 std::vector<FilterParams> filter_params() const;
+
+                /**
+                 * \brief Return the files that may contain points passing
+                 * the filters. The files known by the catalog are pruned
+                 * by their bounds and classes, the others are always
+                 * included.
+                 */
                 std::vector<boost::filesystem::path> filenames() const;
 
+                /**
+                 * \brief Return the files that may contain points passing
+                 * the given filters instead of the ones of the data source.
+                 */
+                std::vector<boost::filesystem::path> filenames(
+                    const std::vector<FilterParams> &filter_params) const;
+
+                /**
+                 * \brief Return the catalog entry of the file, or nullptr
+                 * if it is not known.
+                 */
+                const PointCloudFileInfo * file_info(
+                    const boost::filesystem::path &) const;
+
             private:
+                using BoxPoint = boost::geometry::model::d2::point_xy<double>;
+                using Box = boost::geometry::model::box<BoxPoint>;
+                using FileIndex = boost::geometry::index::rtree<
+                    std::pair<Box, size_t>,
+                    boost::geometry::index::quadratic<16>>;
+
                 std::vector<boost::filesystem::path> filenames_;
                 std::vector<FilterParams> filter_params_;
+                /// Catalog entries of the files, nullptr if not known.
+                std::vector<std::unique_ptr<PointCloudFileInfo>> file_info_;
+                /// The index of each file in filenames_ by its path.
+                std::unordered_map<std::string, size_t> file_numbers_;
+                FileIndex file_index_;
+
+                std::vector<bool> files_overlapping(const Box &) const;
         };
 
         template<typename R>
         bool fill_array(
             R & raster,
-            const PointCloudDataSource & src);
+            const PointCloudDataSource & src,
+            const ProcessingOptions & options = ProcessingOptions());
+
+        /**
+         * \brief Interpolate the raster in bands of band_height rows and
+         * pass each band to \a output as soon as it is done, so that the
+         * whole raster never needs to be in memory.
+         *
+         * The raster gives only the area and the no-data value, its data
+         * is not used. The bands are passed in the order of the rows as
+         * output(const T *rows, unsigned int row_start, unsigned int
+         * n_rows). With stream_rows the bands of the streaming mode are
+         * rounded up to multiples of band_height, and with tile_size each
+         * row of tiles is passed as one band.
+         */
+        template<typename R, typename O>
+        bool fill_array_banded(
+            R & raster,
+            const PointCloudDataSource & src,
+            unsigned int band_height,
+            O & output,
+            const ProcessingOptions & options = ProcessingOptions());
+
+        /**
+         * \brief Interpolate the nx x ny array whose first pixel center is
+         * at upper_left from the TIN in bands of rows in n_threads
+         * threads.
+         *
+         * The TIN is only read, and each thread keeps its own location
+         * hint, so the result is the same as with a single thread. With
+         * \a verbose the progress is printed. Return the number of the
+         * pixels outside of the TIN.
+         */
+        template<typename T>
+        size_t interpolate_rows_parallel(
+            const geo::PixelCenterCoordinate & upper_left,
+            double resolution,
+            T * data,
+            unsigned int nx,
+            unsigned int ny,
+            const Interpolator & ip,
+            unsigned int n_threads,
+            bool verbose)
+        {
+            const unsigned int band_height {16};
+            const unsigned int n_bands {(ny + band_height - 1) / band_height};
+            std::mutex m;
+            unsigned int next_band {0};
+            unsigned int n_done {0};
+            unsigned int prog {0};
+            size_t n_outside {0};
+            auto worker = [&]() {
+                Interpolator::Face_handle hint;
+                Interpolator::Kernel kernel;
+                for (;;) {
+                    unsigned int band;
+                    {
+                        std::lock_guard<std::mutex> lock {m};
+                        if (next_band >= n_bands) {
+                            n_outside += kernel.number_outside();
+                            return;
+                        }
+                        band = next_band++;
+                    }
+                    unsigned int row_start {band * band_height};
+                    unsigned int row_stop {std::min(row_start + band_height, ny)};
+                    hint = ip.fill_rows(
+                        upper_left,
+                        resolution,
+                        data,
+                        nx,
+                        row_start, row_stop,
+                        hint, kernel);
+                    if (!verbose) continue;
+                    std::lock_guard<std::mutex> lock {m};
+                    n_done += row_stop - row_start;
+                    while ((n_done * 10) / ny > prog)
+                        std::cout << (++prog * 10) << " %" << std::endl;
+                }
+            };
+            std::vector<std::thread> threads;
+            for (unsigned int t = 0; t < std::max(n_threads, 1u); ++t) {
+                threads.emplace_back(worker);
+            }
+            for (auto &t: threads) t.join();
+            return n_outside;
+        }
+
+        /**
+         * \brief Interpolate the rows [row_start, row_stop) of the raster
+         * from the TIN in n_threads threads. Return the number of the
+         * pixels outside of the TIN.
+         */
+        template<typename R>
+        size_t interpolate_rows_parallel(
+            R & raster,
+            const Interpolator & ip,
+            unsigned int row_start,
+            unsigned int row_stop,
+            unsigned int n_threads,
+            bool verbose)
+        {
+            return interpolate_rows_parallel(
+                raster.to_geocoordinate(
+                    coordinates::RasterCoordinate {0, row_start}),
+                raster.area().cell_size(),
+                raster.data() + static_cast<size_t>(row_start) * raster.pixel_width(),
+                raster.pixel_width(),
+                row_stop - row_start,
+                ip, n_threads, verbose);
+        }
+
+        /**
+         * \brief Interpolate the whole raster from the TIN in n_threads
+         * threads. Return the number of the pixels outside of the TIN.
+         */
+        template<typename R>
+        size_t interpolate_parallel(
+            R & raster,
+            const Interpolator & ip,
+            unsigned int n_threads)
+        {
+            return interpolate_rows_parallel(raster, ip, 0, raster.pixel_height(),
+                n_threads, true);
+        }
+
+        /**
+         * \brief Read the points of the data source to a new interpolator
+         * and build its TIN.
+         */
+        template<typename R>
+        Interpolator create_interpolator(
+            const R & raster,
+            const PointCloudDataSource & src,
+            const std::vector<FilterParams> & filter_params,
+            const ProcessingOptions & options)
+        {
+            Interpolator ip;
+            // The coordinates of the TIN are relative to the upper left
+            // corner of the raster.
+            const geo::PixelCenterCoordinate ul {
+                raster.to_geocoordinate(coordinates::RasterCoordinate {0, 0})};
+            ip.set_origin(ul.x(), ul.y());
+            ip.set_value_scale(raster.scale(), raster.offset());
+            ip.set_thinning(options.thinning, options.thinning_cell_size);
+            // The pipeline overlaps the insertion with the reading, so it
+            // inserts the points one by one.
+            bool bulk {options.bulk_tin && !options.pipelined};
+            ip.set_bulk_insertion(bulk);
+            if (options.parallel_tin) ip.set_tin_threads(options.n_threads);
+            if (bulk && options.thinning == ThinningPolicy::NONE) {
+                ip.reserve(estimate_number_of_points(src, filter_params));
+            }
+            read_points(src, filter_params, ip, options);
+            ip.finish_insertion();
+            if (ip.number_of_duplicates() > 0) {
+                std::cout << "Ignored " << ip.number_of_duplicates()
+                    << " points with the same x and y as an earlier point."
+                    << std::endl;
+            }
+            std::cout << "Created a TIN interpolator from "
+                << ip.number_of_points() << " points." << std::endl;
+            return ip;
+        }
+
+        /**
+         * \brief Interpolate the raster in tiles, each from its own TIN.
+         *
+         * The TIN of a tile is built from the points within tile_halo of
+         * the pixel centers of the tile, and only the pixels of the tile
+         * are interpolated from it. The points are read for one row of
+         * tiles at a time from the files overlapping the row, so only the
+         * points of a row are in memory. The tiles of each row of tiles
+         * are processed in n_threads threads, and the row is then passed to
+         * \a output as in fill_array_banded(). When the halo is wide
+         * enough to hold the natural neighbors of all the pixels of the
+         * tile, the result is the same as with a single TIN.
+         */
+        template<typename R, typename O>
+        bool fill_array_tiled(
+            R & raster,
+            const PointCloudDataSource & src,
+            const std::vector<FilterParams> & filter_params,
+            const ProcessingOptions & options,
+            O & output)
+        {
+            const unsigned int nx {raster.pixel_width()};
+            const unsigned int ny {raster.pixel_height()};
+            const unsigned int ts {options.tile_size};
+            const unsigned int n_tx {(nx + ts - 1) / ts};
+            const unsigned int n_ty {(ny + ts - 1) / ts};
+            const size_t n_tiles {static_cast<size_t>(n_tx) * n_ty};
+            const double res {raster.area().cell_size()};
+            const geo::PixelCenterCoordinate ul {
+                raster.to_geocoordinate(coordinates::RasterCoordinate {0, 0})};
+            const double halo {options.tile_halo};
+            std::cout << "Interpolating " << n_tiles << " tiles of "
+                << ts << " x " << ts << " pixels." << std::endl;
+
+            // The points of a row of tiles, and the indexes of the points
+            // of each tile of the row.
+            PointBuffer points;
+            std::vector<std::vector<size_t>> tile_points(n_tx);
+            ProcessingOptions read_options {options};
+            auto read_tile_row = [&](unsigned int ty) {
+                unsigned int row0 {ty * ts};
+                unsigned int h {std::min(ts, ny - row0)};
+                // Only the points within the halo of the pixel centers of
+                // the row of tiles are read, with a margin for the
+                // rounding; the exact test is below.
+                const double margin {halo + res};
+                const double top {ul.y() - row0 * res + margin};
+                const double bottom {ul.y() - (row0 + h - 1) * res - margin};
+                std::vector<FilterParams> row_params {filter_params};
+                row_params.push_back({PointFilterType::KEEP_WINDOW, {
+                    boost::lexical_cast<std::string>(ul.x() - margin),
+                    boost::lexical_cast<std::string>(top),
+                    boost::lexical_cast<std::string>((nx - 1) * res + 2 * margin),
+                    boost::lexical_cast<std::string>(top - bottom)}});
+                points.reset();
+                read_points(src, row_params, points, read_options);
+                // read_points() has told about the options it does not
+                // use, so they are not repeated for the next rows.
+                read_options.pipelined = false;
+                read_options.split_files = false;
+
+                // Add each point to all the tiles of the row that have a
+                // pixel center within the halo from it.
+                for (size_t k = 0; k < points.size(); ++k) {
+                    double c0 {std::max(0.0,
+                        std::ceil((points.x(k) - halo - ul.x()) / res))};
+                    double c1 {std::min(static_cast<double>(nx) - 1,
+                        std::floor((points.x(k) + halo - ul.x()) / res))};
+                    double r0 {std::max(static_cast<double>(row0),
+                        std::ceil((ul.y() - points.y(k) - halo) / res))};
+                    double r1 {std::min(static_cast<double>(row0 + h) - 1,
+                        std::floor((ul.y() - points.y(k) + halo) / res))};
+                    if (c0 > c1 || r0 > r1) continue;
+                    unsigned int tx0 {static_cast<unsigned int>(c0) / ts};
+                    unsigned int tx1 {static_cast<unsigned int>(c1) / ts};
+                    for (unsigned int tx = tx0; tx <= tx1; ++tx) {
+                        tile_points[tx].push_back(k);
+                    }
+                }
+            };
+
+            using T = typename R::value_type;
+            std::vector<T> rows;
+            std::mutex m;
+            size_t next_tile {0};
+            size_t tiles_stop {0};
+            size_t n_done {0};
+            unsigned int prog {0};
+            size_t n_outside {0};
+            std::exception_ptr error;
+            auto worker = [&]() {
+                std::vector<T> tile_data;
+                Interpolator::Kernel kernel;
+                for (;;) {
+                    size_t t;
+                    {
+                        std::lock_guard<std::mutex> lock {m};
+                        if (error || next_tile >= tiles_stop) {
+                            n_outside += kernel.number_outside();
+                            return;
+                        }
+                        t = next_tile++;
+                    }
+                    try {
+                        Interpolator ip;
+                        ip.set_origin(ul.x(), ul.y());
+                        ip.set_value_scale(raster.scale(), raster.offset());
+                        ip.set_thinning(options.thinning, options.thinning_cell_size);
+                        ip.set_bulk_insertion(true);
+                        std::vector<size_t> &indexes {tile_points[t % n_tx]};
+                        if (options.thinning == ThinningPolicy::NONE) {
+                            ip.reserve(indexes.size());
+                        }
+                        for (size_t k: indexes) {
+                            ip.insert_point(
+                                geo::GeoCoordinate {points.x(k), points.y(k)},
+                                points.z(k));
+                        }
+                        std::vector<size_t>().swap(indexes);
+                        ip.finish_insertion();
+
+                        // The tiles of the row write to separate columns
+                        // of the rows.
+                        unsigned int col0 {static_cast<unsigned int>(t % n_tx) * ts};
+                        unsigned int row0 {static_cast<unsigned int>(t / n_tx) * ts};
+                        unsigned int w {std::min(ts, nx - col0)};
+                        unsigned int h {std::min(ts, ny - row0)};
+                        tile_data.assign(static_cast<size_t>(w) * h,
+                            raster.no_data_value());
+                        geo::PixelCenterCoordinate tile_ul {raster.to_geocoordinate(
+                            coordinates::RasterCoordinate {col0, row0})};
+                        if (ip.number_of_points() < 3) {
+                            // Not enough points for a TIN, leave the tile
+                            // empty.
+                        } else if (options.interpolation ==
+                                   InterpolationMethod::TIN_LINEAR) {
+                            ip.fill_array_linear(tile_ul, res, tile_data.data(), w, h);
+                        } else {
+                            ip.fill_rows(tile_ul, res, tile_data.data(), w, 0, h,
+                                Interpolator::Face_handle(), kernel);
+                        }
+                        for (unsigned int j = 0; j < h; ++j) {
+                            std::copy(
+                                tile_data.begin() + static_cast<size_t>(j) * w,
+                                tile_data.begin() + static_cast<size_t>(j + 1) * w,
+                                rows.begin() + static_cast<size_t>(j) * nx + col0);
+                        }
+                    } catch (...) {
+                        std::lock_guard<std::mutex> lock {m};
+                        if (!error) error = std::current_exception();
+                        return;
+                    }
+                    std::lock_guard<std::mutex> lock {m};
+                    ++n_done;
+                    while ((n_done * 10) / n_tiles > prog)
+                        std::cout << (++prog * 10) << " %" << std::endl;
+                }
+            };
+            unsigned int n_threads {std::max(options.n_threads, 1u)};
+            for (unsigned int ty = 0; ty < n_ty; ++ty) {
+                unsigned int row0 {ty * ts};
+                unsigned int h {std::min(ts, ny - row0)};
+                read_tile_row(ty);
+                rows.assign(static_cast<size_t>(h) * nx, raster.no_data_value());
+                next_tile = static_cast<size_t>(ty) * n_tx;
+                tiles_stop = next_tile + n_tx;
+                std::vector<std::thread> threads;
+                for (unsigned int i = 0; i < std::min(n_threads, n_tx); ++i) {
+                    threads.emplace_back(worker);
+                }
+                for (auto &th: threads) th.join();
+                if (error) std::rethrow_exception(error);
+                output(static_cast<const T *>(rows.data()), row0, h);
+            }
+            report_pixels_outside(n_outside);
+            return true;
+        }
+
+        /**
+         * \brief Interpolate the raster in bands of stream_rows rows
+         * reading the files from north to south.
+         *
+         * The points of each file are added to the bands that have a pixel
+         * center within tile_halo of them. A band is final when the
+         * remaining files all lie more than tile_halo below its rows: its
+         * TIN is then built, interpolated to the rows of the band, passed
+         * to \a output as in fill_array_banded() and freed. Only the bands
+         * between the files being read and the last final band are kept
+         * in memory, so the memory depends on the height of the files and
+         * not on the number of points. The files are read as by
+         * read_files(), so the next files are read in n_threads threads
+         * while a band is interpolated.
+         */
+        template<typename R, typename O>
+        bool fill_array_streaming(
+            R & raster,
+            const PointCloudDataSource & src,
+            const std::vector<FilterParams> & filter_params,
+            const ProcessingOptions & options,
+            O & output)
+        {
+            const unsigned int nx {raster.pixel_width()};
+            const unsigned int ny {raster.pixel_height()};
+            const unsigned int bh {options.stream_rows};
+            const unsigned int n_bands {(ny + bh - 1) / bh};
+            const double res {raster.area().cell_size()};
+            const geo::PixelCenterCoordinate ul {
+                raster.to_geocoordinate(coordinates::RasterCoordinate {0, 0})};
+            const double halo {options.tile_halo};
+
+            // The y of the pixel centers of the last row of the band.
+            auto band_bottom = [&](unsigned int b) {
+                return ul.y() - (std::min((b + 1) * bh, ny) - 1) * res;
+            };
+
+            using T = typename R::value_type;
+            std::vector<T> rows;
+            std::vector<PointBuffer> bands(n_bands);
+            size_t n_outside {0};
+            auto finish_band = [&](unsigned int b) {
+                Interpolator ip;
+                ip.set_origin(ul.x(), ul.y());
+                ip.set_value_scale(raster.scale(), raster.offset());
+                ip.set_thinning(options.thinning, options.thinning_cell_size);
+                ip.set_bulk_insertion(true);
+                if (options.parallel_tin) ip.set_tin_threads(options.n_threads);
+                if (options.thinning == ThinningPolicy::NONE) {
+                    ip.reserve(bands[b].size());
+                }
+                bands[b].insert_to(ip);
+                bands[b].clear();
+                ip.finish_insertion();
+
+                unsigned int row0 {b * bh};
+                unsigned int h {std::min(bh, ny - row0)};
+                rows.assign(static_cast<size_t>(h) * nx, raster.no_data_value());
+                geo::PixelCenterCoordinate band_ul {raster.to_geocoordinate(
+                    coordinates::RasterCoordinate {0, row0})};
+                if (ip.number_of_points() < 3) {
+                    // Not enough points for a TIN, leave the rows empty.
+                } else if (options.interpolation ==
+                           InterpolationMethod::TIN_LINEAR) {
+                    ip.fill_array_linear(band_ul, res, rows.data(), nx, h);
+                } else {
+                    n_outside += interpolate_rows_parallel(band_ul, res,
+                        rows.data(), nx, h, ip, options.n_threads, false);
+                }
+                output(static_cast<const T *>(rows.data()), row0, h);
+                std::cout << "Interpolated the rows " << row0 << "-"
+                    << (row0 + h - 1) << " of " << ny << " from "
+                    << ip.number_of_points() << " points." << std::endl;
+            };
+
+            std::vector<std::pair<boost::filesystem::path, double>> files {
+                files_from_north(src)};
+            std::cout << "Streaming " << files.size() << " files to "
+                << n_bands << " bands of " << bh << " rows." << std::endl;
+            std::vector<boost::filesystem::path> filenames;
+            for (const auto &f: files) filenames.push_back(f.first);
+            unsigned int next_band {0};
+            size_t n_late {0};
+            read_files(filenames, filter_params, options,
+                [&](size_t i, const PointBuffer &points) {
+                    for (size_t k = 0; k < points.size(); ++k) {
+                        double c0 {std::max(0.0,
+                            std::ceil((points.x(k) - halo - ul.x()) / res))};
+                        double c1 {std::min(static_cast<double>(nx) - 1,
+                            std::floor((points.x(k) + halo - ul.x()) / res))};
+                        double r0 {std::max(0.0,
+                            std::ceil((ul.y() - points.y(k) - halo) / res))};
+                        double r1 {std::min(static_cast<double>(ny) - 1,
+                            std::floor((ul.y() - points.y(k) + halo) / res))};
+                        if (c0 > c1 || r0 > r1) continue;
+                        // The bands already finished cannot take more
+                        // points.
+                        unsigned int b0 {static_cast<unsigned int>(r0) / bh};
+                        unsigned int b1 {static_cast<unsigned int>(r1) / bh};
+                        if (b0 < next_band) {
+                            ++n_late;
+                            b0 = next_band;
+                        }
+                        for (unsigned int b = b0; b <= b1; ++b) {
+                            bands[b].insert_point(
+                                geo::GeoCoordinate {points.x(k), points.y(k)},
+                                points.z(k));
+                        }
+                    }
+
+                    double next_top {i + 1 < files.size() ?
+                        files[i + 1].second :
+                        -std::numeric_limits<double>::infinity()};
+                    while (next_band < n_bands &&
+                           band_bottom(next_band) - halo > next_top) {
+                        finish_band(next_band++);
+                    }
+                });
+            while (next_band < n_bands) {
+                finish_band(next_band++);
+            }
+            if (n_late > 0) {
+                std::cout << "Left out " << n_late << " points from the "
+                    << "bands that were already interpolated. Their files "
+                    << "extend further north than their bounds in the catalog "
+                    << "or the header." << std::endl;
+            }
+            report_pixels_outside(n_outside);
+            return true;
+        }
+
         template<typename R>
         bool fill_array(
             R & raster,
-            const PointCloudDataSource & src)
+            const PointCloudDataSource & src,
+            const ProcessingOptions & options)
         {
             std::vector<FilterParams> local_filter_params;
             for (const auto &f: src.filter_params())
@@ -85,33 +802,124 @@ namespace io {
                     local_filter_params.push_back(f);
                 }
             }
-            Interpolator ip;
-            for (const auto &f: src.filenames()) {
-                std::cout << "Importing points from the file '"
-                    << f.string() << "'" << std::endl;
-                size_t n {read_data(f.string(), ip, local_filter_params)};
-                if (n == static_cast<size_t>(0)) {
-                    std::cout <<"  No matching points." << std::endl;
+            if (options.stream_rows > 0 || options.tile_size > 0) {
+                // Copy the bands to the raster.
+                using T = typename R::value_type;
+                const size_t nx {raster.pixel_width()};
+                auto copy_rows = [&raster, nx](
+                    const T *rows, unsigned int row_start, unsigned int n_rows)
+                {
+                    std::copy(rows, rows + n_rows * nx,
+                        raster.data() + row_start * nx);
+                };
+                if (options.stream_rows > 0) {
+                    return fill_array_streaming(
+                        raster, src, local_filter_params, options, copy_rows);
                 }
+                return fill_array_tiled(
+                    raster, src, local_filter_params, options, copy_rows);
             }
-            std::cout << "Created a TIN interpolator from "
-                << ip.number_of_points() << " points." << std::endl;
+            Interpolator ip {create_interpolator(
+                raster, src, local_filter_params, options)};
             std::cout << "Starting to interpolate to "
                 << raster.pixel_width() << " x " << raster.pixel_height()
                 << " grid." << std::endl;
+            if (options.interpolation == InterpolationMethod::TIN_LINEAR) {
+                ip.fill_array_linear(
+                    raster.to_geocoordinate(coordinates::RasterCoordinate {0, 0}),
+                    raster.area().cell_size(),
+                    raster.data(),
+                    raster.pixel_width(),
+                    raster.pixel_height());
+                std::cout << "100 %" << std::endl;
+                return true;
+            }
+            if (options.n_threads > 1) {
+                report_pixels_outside(
+                    interpolate_parallel(raster, ip, options.n_threads));
+                return true;
+            }
             unsigned int ny {raster.pixel_height()};
             unsigned int prog {0};
+            Interpolator::Face_handle hint;
+            Interpolator::Kernel kernel;
             for (unsigned int row = 0; row < ny; ++row) {
-                ip.fill_array(raster.to_geocoordinate(coordinates::RasterCoordinate {0, 0}),
+                hint = ip.fill_rows(raster.to_geocoordinate(coordinates::RasterCoordinate {0, 0}),
                     raster.area().cell_size(),
                     raster.data(),
                     raster.pixel_width(),
                     row, row + 1,
-                    row > 0);
+                    hint, kernel);
                 if ((row * 10)/ ny > prog)
                     std::cout << (++prog * 10) << " %" << std::endl;
             }
             std::cout << "100 %" << std::endl;
+            report_pixels_outside(kernel.number_outside());
+            return true;
+        }
+
+        template<typename R, typename O>
+        bool fill_array_banded(
+            R & raster,
+            const PointCloudDataSource & src,
+            unsigned int band_height,
+            O & output,
+            const ProcessingOptions & options)
+        {
+            std::vector<FilterParams> filter_params {src.filter_params()};
+            if (options.stream_rows > 0) {
+                ProcessingOptions o {options};
+                o.stream_rows = (options.stream_rows + band_height - 1) /
+                    band_height * band_height;
+                return fill_array_streaming(raster, src, filter_params, o, output);
+            }
+            if (options.tile_size > 0) {
+                return fill_array_tiled(raster, src, filter_params, options, output);
+            }
+            Interpolator ip {create_interpolator(
+                raster, src, filter_params, options)};
+            const unsigned int nx {raster.pixel_width()};
+            const unsigned int ny {raster.pixel_height()};
+            const double res {raster.area().cell_size()};
+            std::cout << "Starting to interpolate to " << nx << " x " << ny
+                << " grid in bands of " << band_height << " rows." << std::endl;
+
+            using T = typename R::value_type;
+            std::vector<T> rows;
+            Interpolator::Face_handle hint;
+            Interpolator::Kernel kernel;
+            size_t n_outside {0};
+            // The faces are grouped by the bands once so that each band
+            // only rasterizes the faces over it.
+            std::vector<std::vector<Interpolator::Face_handle>> band_faces;
+            if (options.interpolation == InterpolationMethod::TIN_LINEAR) {
+                band_faces = ip.faces_by_band(
+                    raster.to_geocoordinate(coordinates::RasterCoordinate {0, 0}).y(),
+                    res, band_height, ny);
+            }
+            unsigned int prog {0};
+            for (unsigned int row0 = 0; row0 < ny; row0 += band_height) {
+                unsigned int h {std::min(band_height, ny - row0)};
+                rows.assign(static_cast<size_t>(h) * nx, raster.no_data_value());
+                geo::PixelCenterCoordinate band_ul {raster.to_geocoordinate(
+                    coordinates::RasterCoordinate {0, row0})};
+                if (options.interpolation == InterpolationMethod::TIN_LINEAR) {
+                    std::vector<Interpolator::Face_handle> &faces {
+                        band_faces[row0 / band_height]};
+                    ip.fill_array_linear(band_ul, res, rows.data(), nx, h, faces);
+                    std::vector<Interpolator::Face_handle>().swap(faces);
+                } else if (options.n_threads > 1) {
+                    n_outside += interpolate_rows_parallel(band_ul, res,
+                        rows.data(), nx, h, ip, options.n_threads, false);
+                } else {
+                    hint = ip.fill_rows(band_ul, res, rows.data(), nx, 0, h,
+                        hint, kernel);
+                }
+                output(static_cast<const T *>(rows.data()), row0, h);
+                while (((row0 + h) * 10) / ny > prog)
+                    std::cout << (++prog * 10) << " %" << std::endl;
+            }
+            report_pixels_outside(n_outside + kernel.number_outside());
             return true;
         }
         double get_x(const LASpoint &p);
@@ -0,0 +1,227 @@
+#include "PointPipeline.h"
+
+#include <chrono>
+#include <exception>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <thread>
+
+#include "Interpolator.h"
+#include "PointBatchFilter.h"
+#include "PointBlock.h"
+#include "PointBlockReader.h"
+#include "PointBuffer.h"
+#include "PointCloudDataSource.h"
+#include "framework/utils/SpscQueue.h"
+
+namespace {
+
+    using Clock = std::chrono::steady_clock;
+
+    double seconds_since(const Clock::time_point &t0)
+    {
+        return std::chrono::duration<double>(Clock::now() - t0).count();
+    }
+
+    /**
+     * \brief Call the blocking queue operation and add the time spent in
+     * it to \a wait_seconds.
+     */
+    template<typename F>
+    bool timed_wait(double &wait_seconds, F f)
+    {
+        Clock::time_point t0 {Clock::now()};
+        bool ret {f()};
+        wait_seconds += seconds_since(t0);
+        return ret;
+    }
+
+}
+
+namespace io {
+
+    namespace point_cloud {
+
+        PipelineStageStats::PipelineStageStats(const std::string &name_):
+            name {name_}, blocks {0}, points {0}, elapsed_seconds {0},
+            input_wait_seconds {0}, output_wait_seconds {0}
+        {
+        }
+
+        double PipelineStageStats::busy_seconds() const
+        {
+            return elapsed_seconds - input_wait_seconds - output_wait_seconds;
+        }
+
+        std::string PipelineStageStats::str() const
+        {
+            std::stringstream ss;
+            ss << std::fixed << std::setprecision(2)
+                << "  " << name << ": " << blocks << " blocks, "
+                << points << " points, busy " << busy_seconds() << " s";
+            if (busy_seconds() > 0) {
+                ss << " (" << std::setprecision(1)
+                    << (points / busy_seconds() / 1e6) << " Mpts/s)";
+            }
+            ss << std::setprecision(2)
+                << ", waiting for input " << input_wait_seconds << " s"
+                << ", waiting for output " << output_wait_seconds << " s";
+            return ss.str();
+        }
+
+        size_t read_points_pipelined(
+            const std::vector<boost::filesystem::path> &filenames,
+            const std::vector<FilterParams> &filter_params,
+            Interpolator &ip)
+        {
+            // The blocks and batches circulate between the stages through
+            // the free queues, so nothing is allocated while reading.
+            const size_t n_blocks {16};
+            const size_t n_batches {16};
+            std::vector<PointBlock> blocks(n_blocks);
+            std::vector<PointBuffer> batches(n_batches);
+            utils::SpscQueue<PointBlock*> free_blocks {n_blocks};
+            utils::SpscQueue<PointBlock*> decoded {n_blocks};
+            utils::SpscQueue<PointBuffer*> free_batches {n_batches};
+            utils::SpscQueue<PointBuffer*> filtered {n_batches};
+            for (auto &b: blocks) free_blocks.try_push(&b);
+            for (auto &b: batches) free_batches.try_push(&b);
+
+            auto cancel_all = [&]() {
+                free_blocks.cancel();
+                decoded.cancel();
+                free_batches.cancel();
+                filtered.cancel();
+            };
+
+            PipelineStageStats decode_stats {"decode"};
+            PipelineStageStats filter_stats {"filter"};
+            PipelineStageStats insert_stats {"triangulate"};
+            std::exception_ptr decode_error, filter_error, insert_error;
+
+            std::thread decoder {[&]() {
+                Clock::time_point t0 {Clock::now()};
+                PipelineStageStats &st {decode_stats};
+                try {
+                    PointBlock *block {nullptr};
+                    for (const auto &f: filenames) {
+                        PointBlockReader reader {f.string(), filter_params};
+                        if (!reader.overlaps()) continue;
+                        for (;;) {
+                            if (!block && !timed_wait(st.output_wait_seconds,
+                                    [&]() { return free_blocks.pop(block); }))
+                                return;
+                            if (!reader.read(*block)) break;
+                            ++st.blocks;
+                            st.points += block->size;
+                            if (!timed_wait(st.output_wait_seconds,
+                                    [&]() { return decoded.push(block); }))
+                                return;
+                            block = nullptr;
+                        }
+                    }
+                    decoded.push(nullptr);
+                } catch (...) {
+                    decode_error = std::current_exception();
+                    cancel_all();
+                }
+                st.elapsed_seconds = seconds_since(t0);
+            }};
+
+            std::thread filter {[&]() {
+                Clock::time_point t0 {Clock::now()};
+                PipelineStageStats &st {filter_stats};
+                try {
+                    std::unique_ptr<PointBatchFilter> batch_filter;
+                    Quantization q;
+                    std::vector<std::uint32_t> selected(PointBlock::capacity);
+                    for (;;) {
+                        PointBlock *block;
+                        if (!timed_wait(st.input_wait_seconds,
+                                [&]() { return decoded.pop(block); }))
+                            break;
+                        if (!block) {
+                            filtered.push(nullptr);
+                            break;
+                        }
+                        // The files may have different scales and offsets.
+                        if (!batch_filter || !(block->quantization == q)) {
+                            q = block->quantization;
+                            batch_filter.reset(
+                                new PointBatchFilter(filter_params, q));
+                        }
+                        size_t n {batch_filter->apply(*block, selected.data())};
+                        PointBuffer *batch {nullptr};
+                        if (n > 0) {
+                            if (!timed_wait(st.output_wait_seconds,
+                                    [&]() { return free_batches.pop(batch); }))
+                                break;
+                            batch->reset();
+                            for (size_t k = 0; k < n; ++k) {
+                                size_t i {selected[k]};
+                                batch->insert_point(
+                                    geo::GeoCoordinate {block->x(i), block->y(i)},
+                                    block->z(i));
+                            }
+                        }
+                        ++st.blocks;
+                        st.points += n;
+                        free_blocks.push(block);
+                        if (batch && !timed_wait(st.output_wait_seconds,
+                                [&]() { return filtered.push(batch); }))
+                            break;
+                    }
+                } catch (...) {
+                    filter_error = std::current_exception();
+                    cancel_all();
+                }
+                st.elapsed_seconds = seconds_since(t0);
+            }};
+
+            size_t n_total {0};
+            {
+                Clock::time_point t0 {Clock::now()};
+                PipelineStageStats &st {insert_stats};
+                try {
+                    for (;;) {
+                        PointBuffer *batch;
+                        if (!timed_wait(st.input_wait_seconds,
+                                [&]() { return filtered.pop(batch); }))
+                            break;
+                        if (!batch) break;
+                        batch->insert_to(ip);
+                        ++st.blocks;
+                        st.points += batch->size();
+                        n_total += batch->size();
+                        free_batches.push(batch);
+                    }
+                } catch (...) {
+                    insert_error = std::current_exception();
+                    cancel_all();
+                }
+                st.elapsed_seconds = seconds_since(t0);
+            }
+            decoder.join();
+            filter.join();
+            if (decode_error) std::rethrow_exception(decode_error);
+            if (filter_error) std::rethrow_exception(filter_error);
+            if (insert_error) std::rethrow_exception(insert_error);
+
+            std::cout << "Added " << n_total << " points to the TIN."
+                << std::endl;
+            std::cout << "Pipeline stages:" << std::endl;
+            std::cout << decode_stats.str() << std::endl;
+            std::cout << filter_stats.str() << std::endl;
+            std::cout << insert_stats.str() << std::endl;
+            std::cout << "  queue full/empty waits: decoded "
+                << decoded.push_waits() << "/" << decoded.pop_waits()
+                << ", filtered " << filtered.push_waits() << "/"
+                << filtered.pop_waits() << std::endl;
+            return n_total;
+        }
+
+    }
+
+}
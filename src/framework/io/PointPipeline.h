@@ -0,0 +1,57 @@
+#ifndef POINT_PIPELINE_H_
+#define POINT_PIPELINE_H_
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <boost/filesystem.hpp>
+
+namespace io {
+
+    namespace point_cloud {
+
+        enum class PointFilterType;
+        class Interpolator;
+
+        /**
+         * \brief Throughput counters of one stage of the pipeline.
+         */
+        class PipelineStageStats
+        {
+            public:
+                explicit PipelineStageStats(const std::string &name_);
+
+                std::string name;
+                size_t blocks;
+                size_t points;
+                double elapsed_seconds;
+                double input_wait_seconds;
+                double output_wait_seconds;
+
+                double busy_seconds() const;
+                std::string str() const;
+        };
+
+        /**
+         * \brief Read the points of the files to the interpolator in a
+         * pipeline of three threads.
+         *
+         * A decoder thread reads blocks of points from the files, a filter
+         * thread filters them and the calling thread inserts the points to
+         * the interpolator. The stages are connected with bounded lock-free
+         * queues, so the decoding of the next blocks overlaps with the
+         * triangulation of the current ones. The points are inserted in the
+         * same order as when reading the files serially.
+         */
+        size_t read_points_pipelined(
+            const std::vector<boost::filesystem::path> &filenames,
+            const std::vector<std::pair<PointFilterType,
+                std::vector<std::string>>> &filter_params,
+            Interpolator &ip);
+
+    }
+
+}
+
+#endif
@@ -0,0 +1,150 @@
+#include "PointThinner.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+
+#include "Interpolator.h"
+
+namespace io {
+
+    namespace point_cloud {
+
+        ThinningPolicy thinning_policy_from_string(const std::string &s)
+        {
+            if (s == "none") return ThinningPolicy::NONE;
+            if (s == "lowest") return ThinningPolicy::LOWEST;
+            if (s == "highest") return ThinningPolicy::HIGHEST;
+            if (s == "center") return ThinningPolicy::CENTER;
+            if (s == "median") return ThinningPolicy::MEDIAN;
+            std::stringstream ss;
+            ss << "Unknown thinning policy '" << s << "'.";
+            throw std::runtime_error(ss.str());
+        }
+
+        PointThinner::PointThinner(ThinningPolicy policy, double cell_size):
+            policy_ {policy},
+            cell_size_ {cell_size},
+            n_input_ {0}
+        {
+            if (cell_size_ < 0) {
+                throw std::runtime_error(
+                    "The thinning cell size must not be negative.");
+            }
+        }
+
+        PointThinner::Key PointThinner::key(double x, double y) const
+        {
+            if (cell_size_ == 0) {
+                // Only the exactly equal coordinates share a cell.
+                std::int64_t kx, ky;
+                std::memcpy(&kx, &x, sizeof(kx));
+                std::memcpy(&ky, &y, sizeof(ky));
+                return {kx, ky};
+            }
+            return {static_cast<std::int64_t>(std::floor(x / cell_size_)),
+                static_cast<std::int64_t>(std::floor(y / cell_size_))};
+        }
+
+        bool PointThinner::is_better(
+            const Point &candidate,
+            const Point &current,
+            const Key &k) const
+        {
+            switch (policy_) {
+                case ThinningPolicy::LOWEST:
+                    return candidate.z < current.z;
+                case ThinningPolicy::HIGHEST:
+                    return candidate.z > current.z;
+                case ThinningPolicy::CENTER:
+                {
+                    if (cell_size_ == 0) return false;
+                    double cx {(k.first + 0.5) * cell_size_};
+                    double cy {(k.second + 0.5) * cell_size_};
+                    double d_cand {(candidate.x - cx) * (candidate.x - cx) +
+                        (candidate.y - cy) * (candidate.y - cy)};
+                    double d_cur {(current.x - cx) * (current.x - cx) +
+                        (current.y - cy) * (current.y - cy)};
+                    return d_cand < d_cur;
+                }
+                default:
+                    // The first point is kept.
+                    return false;
+            }
+        }
+
+        void PointThinner::insert_point(
+            const geo::GeoCoordinate &p,
+            double elev)
+        {
+            Point point {p.x(), p.y(), elev};
+            Key k {key(point.x, point.y)};
+            auto res = cells_.insert({k, Cell {n_input_, point}});
+            if (!res.second && is_better(point, res.first->second.point, k)) {
+                res.first->second.point = point;
+            }
+            if (policy_ == ThinningPolicy::MEDIAN) {
+                median_points_.push_back({res.first->second.first, point});
+            }
+            ++n_input_;
+        }
+
+        size_t PointThinner::size() const
+        {
+            return cells_.size();
+        }
+
+        std::vector<PointThinner::Point> PointThinner::kept_points()
+        {
+            std::vector<Point> points;
+            points.reserve(cells_.size());
+            if (policy_ == ThinningPolicy::MEDIAN) {
+                // Sorted by the cell, the points of each cell are together
+                // in the order of the elevation and the cells in the order
+                // of their first points.
+                std::sort(median_points_.begin(), median_points_.end(),
+                    [](const std::pair<size_t, Point> &a,
+                       const std::pair<size_t, Point> &b) {
+                        return a.first < b.first ||
+                            (a.first == b.first && a.second.z < b.second.z);
+                    });
+                for (size_t i = 0; i < median_points_.size();) {
+                    size_t j {i};
+                    while (j < median_points_.size() &&
+                        median_points_[j].first == median_points_[i].first) ++j;
+                    // The lower median, so that the kept point is one of
+                    // the points of the cell.
+                    points.push_back(median_points_[i + (j - i - 1) / 2].second);
+                    i = j;
+                }
+                std::vector<std::pair<size_t, Point>>().swap(median_points_);
+                return points;
+            }
+            std::vector<std::pair<size_t, Point>> kept;
+            kept.reserve(cells_.size());
+            for (const auto &c: cells_) kept.push_back({c.second.first, c.second.point});
+            std::sort(kept.begin(), kept.end(),
+                [](const std::pair<size_t, Point> &a,
+                   const std::pair<size_t, Point> &b) {
+                    return a.first < b.first;
+                });
+            for (const auto &k: kept) points.push_back(k.second);
+            return points;
+        }
+
+        void PointThinner::insert_to(Interpolator &ip)
+        {
+            std::vector<Point> points {kept_points()};
+            std::cout << "Thinned " << n_input_ << " points to "
+                << points.size() << " points." << std::endl;
+            for (const auto &p: points) {
+                ip.insert_point(geo::GeoCoordinate {p.x, p.y}, p.z);
+            }
+        }
+
+    }
+
+}
@@ -0,0 +1,101 @@
+#ifndef POINT_THINNER_H_
+#define POINT_THINNER_H_
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "framework/geo.h"
+
+namespace io {
+
+    namespace point_cloud {
+
+        class Interpolator;
+
+        /**
+         * \brief The point kept from each cell of the thinning grid.
+         */
+        enum class ThinningPolicy {NONE, LOWEST, HIGHEST, CENTER, MEDIAN};
+
+        /**
+         * \brief Parse the name of a thinning policy ("none", "lowest",
+         * "highest", "center" or "median").
+         */
+        ThinningPolicy thinning_policy_from_string(const std::string &s);
+
+        /**
+         * \brief Keep one point from each cell of a regular grid.
+         *
+         * The grid is aligned to the origin of the coordinate system. With
+         * the cell size 0 only the points with exactly the same x and y
+         * are collapsed into one. The kept points are inserted to the
+         * interpolator in the order the first point of each cell was
+         * added, so the result does not depend on hashing.
+         */
+        class PointThinner
+        {
+            public:
+                PointThinner(ThinningPolicy policy, double cell_size);
+
+                void insert_point(const geo::GeoCoordinate &, double elev);
+
+                /// Number of points added to the thinner.
+                size_t number_of_input_points() const { return n_input_; }
+                /// Number of points kept.
+                size_t size() const;
+
+                /**
+                 * \brief Insert the kept points to the interpolator. The
+                 * points of the median policy are released.
+                 */
+                void insert_to(Interpolator &ip);
+
+            private:
+                struct Point
+                {
+                    double x, y, z;
+                };
+
+                struct Cell
+                {
+                    /// Sequence number of the first point of the cell.
+                    size_t first;
+                    Point point;
+                };
+
+                using Key = std::pair<std::int64_t, std::int64_t>;
+
+                struct KeyHash
+                {
+                    size_t operator()(const Key &k) const
+                    {
+                        std::uint64_t h {static_cast<std::uint64_t>(k.first)
+                            * 0x9e3779b97f4a7c15ULL};
+                        h ^= static_cast<std::uint64_t>(k.second)
+                            + 0x7f4a7c159e3779b9ULL + (h << 6) + (h >> 2);
+                        return static_cast<size_t>(h);
+                    }
+                };
+
+                ThinningPolicy policy_;
+                double cell_size_;
+                size_t n_input_;
+                std::unordered_map<Key, Cell, KeyHash> cells_;
+                /// All the points with the sequence number of the first
+                /// point of their cell for the median policy.
+                std::vector<std::pair<size_t, Point>> median_points_;
+
+                Key key(double x, double y) const;
+                bool is_better(const Point &candidate, const Point &current,
+                    const Key &k) const;
+                std::vector<Point> kept_points();
+        };
+
+    }
+
+}
+
+#endif
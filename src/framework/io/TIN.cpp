@@ -1,5 +1,13 @@
 #include "TIN.h"
 
+#include <algorithm>
+#include <numeric>
+#include <utility>
+
+#ifndef COMPACT_TIN
+#include "ParallelDelaunay.h"
+#endif
+
 namespace io {
 
     namespace point_cloud {
@@ -17,9 +25,81 @@ namespace io {
             return T_.number_of_vertices();
         }
 
-        void TIN::insert_point(const Point &p)
+        bool TIN::insert_point(const Point &p, double z)
+        {
+#ifdef COMPACT_TIN
+            return T_.insert(p, z);
+#else
+            size_t n {T_.number_of_vertices()};
+            Vertex_handle v {T_.insert(p)};
+            if (T_.number_of_vertices() == n) return false;
+            v->info() = VertexInfo {z};
+            return true;
+#endif
+        }
+
+        size_t TIN::insert_points(
+            const std::vector<Point> &points,
+            const std::vector<double> &z,
+            unsigned int n_threads)
         {
-            T_.insert(p);
+#ifdef COMPACT_TIN
+            // The compact triangulation is built serially and drops the
+            // duplicates itself. The program rejects --parallel-tin with
+            // it.
+            (void)n_threads;
+            return T_.insert(points, z);
+#else
+            // The range insert does not define which one of the points
+            // with the same x and y is kept, so drop the duplicates first
+            // keeping the earliest one.
+            std::vector<size_t> order(points.size());
+            std::iota(order.begin(), order.end(), static_cast<size_t>(0));
+            std::sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+                if (points[a].x() != points[b].x())
+                    return points[a].x() < points[b].x();
+                if (points[a].y() != points[b].y())
+                    return points[a].y() < points[b].y();
+                return a < b;
+            });
+            std::vector<std::pair<Point, VertexInfo>> unique_points;
+            unique_points.reserve(points.size());
+            size_t n_duplicates {0};
+            // The range insert would overwrite the elevation of a vertex
+            // already in the TIN, so those points are dropped as well.
+            const bool has_vertices {T_.number_of_vertices() > 0};
+            Delaunay_triangulation::Face_handle hint;
+            for (size_t k = 0; k < order.size(); ++k) {
+                const Point &p {points[order[k]]};
+                if (k > 0 && p.x() == points[order[k - 1]].x() &&
+                    p.y() == points[order[k - 1]].y()) {
+                    ++n_duplicates;
+                    continue;
+                }
+                if (has_vertices) {
+                    Delaunay_triangulation::Locate_type lt;
+                    int li;
+                    hint = T_.locate(p, lt, li, hint);
+                    if (lt == Delaunay_triangulation::VERTEX) {
+                        ++n_duplicates;
+                        continue;
+                    }
+                }
+                unique_points.push_back({p, VertexInfo {z[order[k]]}});
+            }
+            std::vector<size_t>().swap(order);
+            // The unique points are sorted by x and y as the parallel
+            // construction needs them.
+            if (n_threads > 1 && T_.number_of_vertices() == 0 &&
+                build_delaunay_parallel(T_, unique_points, n_threads)) {
+                return n_duplicates;
+            }
+            // The range insert sorts the points along a Hilbert curve
+            // with the BRIO randomization, so each point is located from
+            // a nearby face.
+            T_.insert(unique_points.begin(), unique_points.end());
+            return n_duplicates;
+#endif
         }
 
     }
@@ -1,8 +1,14 @@
 #ifndef TIN_H_
 #define TIN_H_
 
-#include <CGAL/Exact_predicates_inexact_constructions_kernel.h>
 #include <CGAL/Delaunay_triangulation_2.h>
+#include <CGAL/Triangulation_data_structure_2.h>
+#include <CGAL/Triangulation_vertex_base_with_info_2.h>
+
+#include <vector>
+
+#include "CompactDelaunay.h"
+#include "CountingKernel.h"
 
 namespace io {
 
@@ -15,15 +21,64 @@ namespace io {
             friend class io::point_cloud::Interpolator;
 
             public:
-                using K = CGAL::Exact_predicates_inexact_constructions_kernel;
-                using Delaunay_triangulation = CGAL::Delaunay_triangulation_2<K>;
+                /// The Epick kernel counting the predicates that need
+                /// more than double precision.
+                using K = CountingKernel;
+
+                /**
+                 * \brief The attributes of a point stored in its vertex.
+                 */
+                class VertexInfo
+                {
+                    public:
+                        VertexInfo(): z {0}
+                        {
+                        }
+
+                        explicit VertexInfo(double z_): z {z_}
+                        {
+                        }
+
+                        double z;
+                };
+
+#ifdef COMPACT_TIN
+                /// The points as quantized integers in about a third of
+                /// the memory of the CGAL triangulation.
+                using Delaunay_triangulation = CompactDelaunay;
+#else
+                using Vb = CGAL::Triangulation_vertex_base_with_info_2<VertexInfo, K>;
+                using Tds = CGAL::Triangulation_data_structure_2<Vb>;
+                using Delaunay_triangulation = CGAL::Delaunay_triangulation_2<K, Tds>;
+#endif
+                using Vertex_handle = Delaunay_triangulation::Vertex_handle;
                 using Point = K::Point_2;
 
                 TIN();
                 TIN(const TIN &) = delete;
                 virtual ~TIN();
 
-                void insert_point(const Point &);
+                /**
+                 * \brief Insert the point with the elevation z. Return
+                 * false if there already was a point with the same x and y,
+                 * in which case the old elevation is kept.
+                 */
+                bool insert_point(const Point &, double z);
+                /**
+                 * \brief Insert the points with the elevations z at once.
+                 * The points are sorted spatially before the insertion,
+                 * which makes this much faster than inserting them one by
+                 * one. Return the number of the points ignored because of
+                 * an earlier point with the same x and y.
+                 *
+                 * If the TIN is empty and n_threads is more than one, the
+                 * triangulation is built in parallel from strips of the
+                 * points, see build_delaunay_parallel().
+                 */
+                size_t insert_points(
+                    const std::vector<Point> &,
+                    const std::vector<double> &z,
+                    unsigned int n_threads = 1);
 
                 size_t number_of_points() const;
 
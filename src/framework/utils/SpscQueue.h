@@ -0,0 +1,167 @@
+#ifndef SPSC_QUEUE_H_
+#define SPSC_QUEUE_H_
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace utils {
+
+    /**
+     * \brief A bounded lock-free queue for one producer and one consumer
+     * thread.
+     *
+     * The blocking push() and pop() spin and yield for a while and then
+     * sleep on a condition variable until the other thread makes room or
+     * adds data, so a full queue slows down the producer without burning
+     * a core. The other thread takes the mutex to wake them only when one
+     * is asleep. Both return false once the queue is cancelled. The number
+     * of times a call had to wait is counted.
+     */
+    template<typename T>
+    class SpscQueue
+    {
+        public:
+            explicit SpscQueue(size_t capacity):
+                buffer_(capacity + 1), head_ {0}, padding_ {}, tail_ {0},
+                cancelled_ {false}, n_parked_ {0}, push_waits_ {0},
+                pop_waits_ {0}
+            {
+            }
+
+            SpscQueue(const SpscQueue &) = delete;
+            SpscQueue & operator=(const SpscQueue &) = delete;
+
+            bool try_push(const T &value)
+            {
+                const size_t tail {tail_.load(std::memory_order_relaxed)};
+                const size_t next {increment(tail)};
+                if (next == head_.load(std::memory_order_acquire)) return false;
+                buffer_[tail] = value;
+                tail_.store(next, std::memory_order_release);
+                wake();
+                return true;
+            }
+
+            bool try_pop(T &value)
+            {
+                const size_t head {head_.load(std::memory_order_relaxed)};
+                if (head == tail_.load(std::memory_order_acquire)) return false;
+                value = buffer_[head];
+                head_.store(increment(head), std::memory_order_release);
+                wake();
+                return true;
+            }
+
+            bool push(const T &value)
+            {
+                if (try_push(value)) return true;
+                ++push_waits_;
+                for (unsigned int i = 0; !is_cancelled(); ++i) {
+                    if (try_push(value)) return true;
+                    if (i < max_spins) {
+                        back_off(i);
+                    } else {
+                        park([this]() {
+                            return increment(tail_.load(std::memory_order_relaxed)) !=
+                                head_.load(std::memory_order_acquire);
+                        });
+                    }
+                }
+                return false;
+            }
+
+            bool pop(T &value)
+            {
+                if (try_pop(value)) return true;
+                ++pop_waits_;
+                for (unsigned int i = 0; !is_cancelled(); ++i) {
+                    if (try_pop(value)) return true;
+                    if (i < max_spins) {
+                        back_off(i);
+                    } else {
+                        park([this]() {
+                            return head_.load(std::memory_order_relaxed) !=
+                                tail_.load(std::memory_order_acquire);
+                        });
+                    }
+                }
+                return false;
+            }
+
+            void cancel()
+            {
+                cancelled_.store(true, std::memory_order_release);
+                std::lock_guard<std::mutex> lock {mutex_};
+                cv_.notify_all();
+            }
+            bool is_cancelled() const
+            {
+                return cancelled_.load(std::memory_order_acquire);
+            }
+
+            /// Number of push() calls that found the queue full.
+            size_t push_waits() const { return push_waits_; }
+            /// Number of pop() calls that found the queue empty.
+            size_t pop_waits() const { return pop_waits_; }
+
+        private:
+            std::vector<T> buffer_;
+            // Keep the indexes of the two threads on separate cache lines.
+            std::atomic<size_t> head_;
+            char padding_[64];
+            std::atomic<size_t> tail_;
+            std::atomic<bool> cancelled_;
+            /// Number of the threads asleep in park().
+            std::atomic<int> n_parked_;
+            std::mutex mutex_;
+            std::condition_variable cv_;
+            size_t push_waits_;
+            size_t pop_waits_;
+
+            size_t increment(size_t i) const
+            {
+                return (i + 1) % buffer_.size();
+            }
+
+            /// The tries before a waiting call goes to sleep.
+            static const unsigned int max_spins {256};
+
+            static void back_off(unsigned int i)
+            {
+                if (i > 64) std::this_thread::yield();
+            }
+
+            /**
+             * \brief Sleep until \a ready or the queue is cancelled.
+             *
+             * The count of the sleepers is raised before \a ready is
+             * checked under the mutex, and wake() reads it after changing
+             * the indexes, so one of the two always sees the other.
+             */
+            template<typename Ready>
+            void park(Ready ready)
+            {
+                std::unique_lock<std::mutex> lock {mutex_};
+                n_parked_.fetch_add(1, std::memory_order_seq_cst);
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+                cv_.wait(lock, [&]() { return is_cancelled() || ready(); });
+                n_parked_.fetch_sub(1, std::memory_order_relaxed);
+            }
+
+            void wake()
+            {
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+                if (n_parked_.load(std::memory_order_relaxed) > 0) {
+                    std::lock_guard<std::mutex> lock {mutex_};
+                    cv_.notify_all();
+                }
+            }
+    };
+
+}
+
+#endif
@@ -1,5 +1,7 @@
 #include "ProgramCmdOpts.h"
 
+#include <stdexcept>
+
 #include "framework/geo.h"
 #include "framework/utils/string_utils.h"
 
@@ -37,6 +39,126 @@ ProgramCmdOpts::ProgramCmdOpts():
                 "The reference system string. Options are:\n"
                 "  - full WKT string (inside quotes)\n"
                 "  - EPSG code in format EPSG:<4-digit value>.")
+        ("create-lax",
+                po::bool_switch(&create_lax_)->default_value(false),
+                "Create the missing .lax spatial indexes for the point\n"
+                "cloud files before reading them. The indexes are\n"
+                "used to read only the points near the calculation\n"
+                "window.")
+        ("catalog",
+                po::bool_switch(&update_catalog_)->default_value(false),
+                "Scan the point cloud files missing from the catalogs\n"
+                "of their directories and save the catalogs. The\n"
+                "catalogs are used to skip the files outside of the\n"
+                "calculation window without opening them.")
+        ("threads",
+                po::value<unsigned int>(&n_threads_)->default_value(1),
+                "The number of threads used to read the point cloud\n"
+                "files and to interpolate the raster. The points are\n"
+                "still inserted to the TIN in the order of the files,\n"
+                "so the result does not depend on the number of\n"
+                "threads.")
+        ("pipeline",
+                po::bool_switch(&pipeline_)->default_value(false),
+                "Decode, filter and triangulate the points in separate\n"
+                "threads connected with bounded queues. Prints the\n"
+                "throughput of each stage.")
+        ("split-files",
+                po::bool_switch(&split_files_)->default_value(false),
+                "Decode the chunks of each LAZ file concurrently with\n"
+                "the number of threads given with --threads. Useful\n"
+                "when there are only a few large files.")
+        ("cache-dir",
+                po::value<std::string>(&cache_dir_)->default_value(""),
+                "Directory for caching the filtered points of each\n"
+                "file. Later runs with the same window and classes\n"
+                "read the points from the cache instead of\n"
+                "decompressing the files.")
+        ("thinning",
+                po::value<std::string>(&thinning_)->default_value("none"),
+                "Keep only one point from each cell of a grid before\n"
+                "creating the TIN: lowest, highest, center (closest\n"
+                "to the cell center) or median (of z). Points with\n"
+                "the same x and y are collapsed into one with the\n"
+                "same rule.")
+        ("thinning-cell",
+                po::value<double>(&thinning_cell_size_)->default_value(
+                    -1, "resolution/4"),
+                "The cell size of the thinning grid. With 0 only the\n"
+                "points with the same x and y are collapsed.")
+        ("incremental-tin",
+                po::bool_switch(&incremental_tin_)->default_value(false),
+                "Insert the points to the TIN one by one while\n"
+                "reading instead of building the TIN from all the\n"
+                "points at once. Uses less memory but is slower.")
+        ("parallel-tin",
+                po::bool_switch(&parallel_tin_)->default_value(false),
+                "Build the single TIN in --threads threads from\n"
+                "vertical strips of the points merged into one\n"
+                "Delaunay triangulation.")
+        ("interpolation",
+                po::value<std::string>(&interpolation_)->default_value(
+                    "natural-neighbor"),
+                "The interpolation method: natural-neighbor or\n"
+                "tin-linear (linear on the triangles of the TIN,\n"
+                "much faster but not as smooth).")
+        ("tile-size",
+                po::value<unsigned int>(&tile_size_)->default_value(0),
+                "Interpolate the raster in tiles of this many pixels\n"
+                "in --threads threads, each tile from its own TIN of\n"
+                "the points within include_points_buffer of the tile.\n"
+                "0 builds a single TIN.")
+        ("stream-rows",
+                po::value<unsigned int>(&stream_rows_)->default_value(0),
+                "Read the files from north to south and interpolate\n"
+                "the raster in bands of this many rows, each from\n"
+                "its own TIN freed as soon as no more points of it\n"
+                "are to come. 0 reads all the points first.")
+        ("write-by-bands",
+                po::bool_switch(&write_by_bands_)->default_value(false),
+                "Write the raster to the file in bands of whole\n"
+                "blocks as soon as they are interpolated instead of\n"
+                "keeping the whole raster in memory.")
+        ("write-buffers",
+                po::value<unsigned int>(&write_buffers_)->default_value(2),
+                "With --write-by-bands, the number of bands queued\n"
+                "for a writer thread that compresses and writes them\n"
+                "while the next bands are interpolated. 0 writes in\n"
+                "the interpolating thread.")
+        ("cog",
+                po::bool_switch(&cog_)->default_value(false),
+                "Write a tiled DEFLATE compressed Cloud Optimized\n"
+                "GeoTIFF with the own writer, compressing the tiles\n"
+                "in --threads threads. Implies --write-by-bands;\n"
+                "--output-format is ignored.")
+        ("overviews",
+                po::value<unsigned int>(&overviews_)->default_value(0),
+                "With --cog, the number of overviews reduced by\n"
+                "2, 4, 8, ... to compute from the bands and write\n"
+                "into the same file.")
+        ("overview-resampling",
+                po::value<std::string>(&overview_resampling_)->default_value("average"),
+                "How the overviews are resampled: average (of the\n"
+                "pixels other than NODATA) or nearest.")
+        ("output-type",
+                po::value<std::string>(&output_type_)->default_value("float32"),
+                "The type of the values: float32, float64, int32,\n"
+                "int16 or uint16. The integer types store the\n"
+                "elevations quantized by --output-scale. With the\n"
+                "default scales and no offset the elevations must\n"
+                "be within +-21474836.47 m with int32,\n"
+                "+-3276.7 m with int16 and 0...6553.4 m with uint16;\n"
+                "the values outside are clamped and counted.")
+        ("output-scale",
+                po::value<double>(&output_scale_)->default_value(0),
+                "The values are (elevation - offset) / scale, stored\n"
+                "as the scale and offset of the band. 0 uses 0.01\n"
+                "(cm) for int32, 0.1 (dm) for int16 and uint16 and\n"
+                "1 for the floating point types.")
+        ("output-offset",
+                po::value<double>(&output_offset_)->default_value(0),
+                "The offset subtracted from the elevations before\n"
+                "the scaling.")
         ;
 }
 
@@ -57,6 +179,10 @@ bool ProgramCmdOpts::parse(int argc, char** argv)
     calc_window_ = geo::parse_rectangle_coordinates(
         calc_window_str_, ref_sys_string_);
 
+    if (overviews_ > 0 && !cog_) {
+        throw std::runtime_error("The option --overviews requires --cog.");
+    }
+
     if (! vm_.count("output-format")) {
         output_format_ = "gtiff";
     }
@@ -94,6 +220,13 @@ double ProgramCmdOpts::resolution() const
     return resolution_;
 }
 
+double ProgramCmdOpts::thinning_cell_size() const
+{
+    if (thinning_cell_size_ < 0)
+        return resolution() / 4;
+    return thinning_cell_size_;
+}
+
 std::vector<unsigned int> ProgramCmdOpts::classes() const
 {
     return utils::string_to_uints(classes_str_);
@@ -31,6 +31,88 @@ class ProgramCmdOpts
             return output_file_;
         }
 
+        bool create_lax() const {
+            return create_lax_;
+        }
+
+        bool update_catalog() const {
+            return update_catalog_;
+        }
+
+        unsigned int threads() const {
+            return n_threads_ > 0 ? n_threads_ : 1;
+        }
+
+        bool pipeline() const {
+            return pipeline_;
+        }
+
+        bool split_files() const {
+            return split_files_;
+        }
+
+        const std::string & cache_dir() const {
+            return cache_dir_;
+        }
+
+        const std::string & thinning() const {
+            return thinning_;
+        }
+
+        double thinning_cell_size() const;
+
+        bool incremental_tin() const {
+            return incremental_tin_;
+        }
+
+        bool parallel_tin() const {
+            return parallel_tin_;
+        }
+
+        const std::string & interpolation() const {
+            return interpolation_;
+        }
+
+        unsigned int tile_size() const {
+            return tile_size_;
+        }
+
+        unsigned int stream_rows() const {
+            return stream_rows_;
+        }
+
+        bool write_by_bands() const {
+            return write_by_bands_;
+        }
+
+        unsigned int write_buffers() const {
+            return write_buffers_;
+        }
+
+        bool cog() const {
+            return cog_;
+        }
+
+        unsigned int overviews() const {
+            return overviews_;
+        }
+
+        const std::string & overview_resampling() const {
+            return overview_resampling_;
+        }
+
+        const std::string & output_type() const {
+            return output_type_;
+        }
+
+        double output_scale() const {
+            return output_scale_;
+        }
+
+        double output_offset() const {
+            return output_offset_;
+        }
+
         std::string classes_str() const;
         std::vector<unsigned int> classes() const;
 
@@ -49,6 +131,27 @@ class ProgramCmdOpts
         geo::Area calc_window_;
         double resolution_;
         double include_points_buffer_;
+        bool create_lax_;
+        bool update_catalog_;
+        unsigned int n_threads_;
+        bool pipeline_;
+        bool split_files_;
+        std::string cache_dir_;
+        std::string thinning_;
+        double thinning_cell_size_;
+        bool incremental_tin_;
+        std::string interpolation_;
+        unsigned int tile_size_;
+        bool parallel_tin_;
+        unsigned int stream_rows_;
+        bool write_by_bands_;
+        unsigned int write_buffers_;
+        bool cog_;
+        unsigned int overviews_;
+        std::string overview_resampling_;
+        std::string output_type_;
+        double output_scale_;
+        double output_offset_;
 };
 
 #endif
@@ -1,18 +1,111 @@
 #include "program.h"
 #include "ProgramCmdOpts.h"
+
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+#include <type_traits>
+
 #include "framework/Raster.h"
+#include "framework/io/AsyncBandWriter.h"
+#include "framework/io/CogWriter.h"
 #include "framework/io/GDALRasterPrinter.h"
 #include "framework/io/PointCloudDataSource.h"
 
+namespace {
+
+    /**
+     * \brief Interpolate the raster in bands of whole blocks of the
+     * writer and pass each band to the writer as soon as it is ready.
+     */
+    template<typename R, typename W>
+    void fill_by_bands(
+        R & raster,
+        io::point_cloud::PointCloudDataSource & data_src,
+        W & writer,
+        const ProgramCmdOpts & opts,
+        const io::point_cloud::ProcessingOptions & proc_opts)
+    {
+        // The bands are tall enough to keep the threads busy.
+        unsigned int block_height {writer.block_height()};
+        unsigned int band_height {(256 + block_height - 1) / block_height * block_height};
+        if (opts.write_buffers() > 0) {
+            // Compress and write the bands in a separate thread while
+            // the next bands are interpolated.
+            io::GDAL::AsyncBandWriter<typename R::value_type, W> async_writer {
+                writer, raster.pixel_width(), opts.write_buffers()};
+            io::point_cloud::fill_array_banded(
+                raster, data_src, band_height, async_writer, proc_opts);
+            async_writer.finish();
+        } else {
+            io::point_cloud::fill_array_banded(
+                raster, data_src, band_height, writer, proc_opts);
+        }
+    }
+
+    /**
+     * \brief Create the raster of the type T for the DEM, interpolate it
+     * and write it to the output file.
+     *
+     * The integer types store the elevations quantized by the scale,
+     * default_scale unless --output-scale is given, and --output-offset.
+     * Their NODATA value is the lowest value of a signed type and the
+     * highest one of an unsigned type.
+     */
+    template<typename T>
+    void write_dem(
+        const ProgramCmdOpts & opts,
+        io::point_cloud::PointCloudDataSource & data_src,
+        const geo::RasterArea & calc_area,
+        const io::point_cloud::ProcessingOptions & proc_opts,
+        double default_scale)
+    {
+        // Create the raster for the DEM and set the NODATA value.
+        Raster<T> new_dem { calc_area, "DEM" };
+        if (!std::is_integral<T>::value) {
+            new_dem.no_data_value(9999);
+        } else if (std::is_signed<T>::value) {
+            new_dem.no_data_value(std::numeric_limits<T>::lowest());
+        } else {
+            new_dem.no_data_value(std::numeric_limits<T>::max());
+        }
+        double scale {opts.output_scale() > 0 ? opts.output_scale() : default_scale};
+        new_dem.scale_offset(scale, opts.output_offset());
+
+        boost::filesystem::path output_file {
+            boost::filesystem::path(opts.output_path()) / boost::filesystem::path(opts.output_name())};
+        if (opts.cog()) {
+            // Compress the tiles of each band in the threads and append them
+            // to the file without going through GDAL, reducing the bands to
+            // the overviews on the way.
+            io::tiff::CogWriter writer {
+                new_dem, output_file, opts.threads(), opts.overviews(),
+                io::tiff::overview_resampling_from_string(opts.overview_resampling())};
+            fill_by_bands(new_dem, data_src, writer, opts, proc_opts);
+            writer.close();
+        } else if (opts.write_by_bands()) {
+            // Write each band of rows to the file as soon as it has been
+            // interpolated without allocating the whole raster.
+            io::GDAL::RasterBandWriter<T> writer {
+                new_dem, output_file, opts.output_format()};
+            fill_by_bands(new_dem, data_src, writer, opts, proc_opts);
+        } else {
+            // Format the array with the NODATA value, fill it, and write the
+            // resulting raster to a file.
+            new_dem.format();
+            io::point_cloud::fill_array(new_dem, data_src, proc_opts);
+            io::GDAL::write(new_dem, output_file, opts.output_format());
+        }
+    }
+
+}
+
 int program(
     const ProgramCmdOpts & opts)
 {
-    using DemDataType = float;
-    using DemClass = Raster<DemDataType>;
-
     // Create a data source from the given files.
     auto data_src = io::point_cloud::create_data_source(
-        opts.point_cloud_data_str());
+        opts.point_cloud_data_str(), opts.update_catalog());
 
     {
         // Create the filter window.
@@ -31,24 +124,64 @@ int program(
         }
     }
 
+    if (opts.create_lax()) {
+        // Index the files once so that the reads below only touch the
+        // parts of the files near the calculation window.
+        io::point_cloud::create_missing_lax_indexes(*data_src);
+    }
+
     geo::RasterArea calc_area {
         opts.calculation_area(), opts.resolution() };
 
-    // Create the raster for the DEM, set the NODATA value, and format the
-    // array with that value.
-    DemClass new_dem { calc_area, "DEM" };
-    new_dem.no_data_value(9999);
-    new_dem.format();
-
     // Read points from the point cloud files, generate TIN from the points, and
     // interpolate the TIN on the raster cells.
-    io::point_cloud::fill_array(new_dem, *data_src);
+    io::point_cloud::ProcessingOptions proc_opts;
+    proc_opts.n_threads = opts.threads();
+    proc_opts.pipelined = opts.pipeline();
+    proc_opts.split_files = opts.split_files();
+    proc_opts.cache_dir = opts.cache_dir();
+    proc_opts.thinning = io::point_cloud::thinning_policy_from_string(
+        opts.thinning());
+    proc_opts.thinning_cell_size = opts.thinning_cell_size();
+    proc_opts.bulk_tin = !opts.incremental_tin();
+    proc_opts.parallel_tin = opts.parallel_tin();
+#ifdef COMPACT_TIN
+    if (proc_opts.parallel_tin) {
+        throw std::runtime_error("The option --parallel-tin is not supported "
+            "when the program is built with COMPACT_TIN.");
+    }
+#endif
+    proc_opts.interpolation = io::point_cloud::interpolation_method_from_string(
+        opts.interpolation());
+    proc_opts.tile_size = opts.tile_size();
+    proc_opts.tile_halo = opts.include_points_buffer();
+    proc_opts.stream_rows = opts.stream_rows();
 
-    // Write the resulting raster to a file.
-    io::GDAL::write(
-        new_dem,
-        boost::filesystem::path(opts.output_path()) / boost::filesystem::path(opts.output_name()),
-        opts.output_format());
+    // Interpolate and write the DEM in the output type.
+    const std::string &type {opts.output_type()};
+    if (type == "float32") {
+        write_dem<float>(opts, *data_src, calc_area, proc_opts, 1);
+    } else if (type == "float64") {
+        write_dem<double>(opts, *data_src, calc_area, proc_opts, 1);
+    } else if (type == "int32") {
+        write_dem<std::int32_t>(opts, *data_src, calc_area, proc_opts, 0.01);
+    } else if (type == "int16") {
+        write_dem<std::int16_t>(opts, *data_src, calc_area, proc_opts, 0.1);
+    } else if (type == "uint16") {
+        write_dem<std::uint16_t>(opts, *data_src, calc_area, proc_opts, 0.1);
+    } else {
+        std::stringstream ss;
+        ss << "Unknown output type '" << type << "'.";
+        throw std::runtime_error(ss.str());
+    }
+    if (io::point_cloud::number_of_clamped_values() > 0) {
+        std::cout << "Clamped " << io::point_cloud::number_of_clamped_values()
+            << " values outside of the range of " << type << ". Change "
+            << "--output-scale or --output-offset to store them." << std::endl;
+    }
+    std::cout << "The predicates needed more than double precision "
+        << io::point_cloud::number_of_exact_predicates() << " times."
+        << std::endl;
 
     return 0;
 }
@@ -0,0 +1,412 @@
+/*
+ * Compare the triangulations of CompactDelaunay and
+ * build_delaunay_parallel() and the natural neighbor coordinates of
+ * NaturalNeighborKernel with CGAL's Delaunay_triangulation_2 and
+ * natural_neighbor_coordinates_2 on random and degenerate point sets.
+ * Return nonzero if any of the comparisons fails.
+ */
+
+#include <CGAL/Delaunay_triangulation_2.h>
+#include <CGAL/Exact_predicates_inexact_constructions_kernel.h>
+#include <CGAL/natural_neighbor_coordinates_2.h>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+#include <iterator>
+#include <map>
+#include <random>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "framework/io/CompactDelaunay.h"
+#include "framework/io/NaturalNeighborKernel.h"
+#include "framework/io/ParallelDelaunay.h"
+#include "framework/io/TIN.h"
+
+namespace {
+
+    using Epick = CGAL::Exact_predicates_inexact_constructions_kernel;
+    using Point = Epick::Point_2;
+    using Reference = CGAL::Delaunay_triangulation_2<Epick>;
+    using io::point_cloud::CompactDelaunay;
+    using io::point_cloud::NaturalNeighborKernel;
+
+    /// The points are on a grid of 1/1024 m so that the quantization of
+    /// CompactDelaunay and the midpoints of the edges are exact.
+    const double unit {1.0 / 1024};
+    const double x_origin {400000};
+    const double y_origin {6700000};
+
+    /// A point as integer units from the origin.
+    using Key = std::pair<std::int64_t, std::int64_t>;
+    /// The vertices of a triangle in increasing order.
+    using Triangle = std::array<Key, 3>;
+
+    int n_failures {0};
+
+    void check(bool ok, const std::string &test, const std::string &what)
+    {
+        if (!ok) {
+            std::cout << test << ": " << what << " failed" << std::endl;
+            ++n_failures;
+        }
+    }
+
+    Point point(std::int64_t x, std::int64_t y)
+    {
+        return Point(x_origin + x * unit, y_origin + y * unit);
+    }
+
+    Key key(const Point &p)
+    {
+        return Key {std::llround((p.x() - x_origin) / unit),
+            std::llround((p.y() - y_origin) / unit)};
+    }
+
+    std::vector<Point> random_points(std::mt19937_64 &rng, size_t n)
+    {
+        std::uniform_int_distribution<std::int64_t> u {0, (1 << 20) - 1};
+        std::vector<Point> points;
+        for (size_t i = 0; i < n; ++i) {
+            std::int64_t x {u(rng)};
+            points.push_back(point(x, u(rng)));
+        }
+        return points;
+    }
+
+    /// A grid of nx x ny points, in which every square is cocircular.
+    std::vector<Point> grid_points(std::int64_t nx, std::int64_t ny)
+    {
+        std::vector<Point> points;
+        for (std::int64_t y = 0; y < ny; ++y) {
+            for (std::int64_t x = 0; x < nx; ++x) {
+                points.push_back(point(1024 * x, 1024 * y));
+            }
+        }
+        return points;
+    }
+
+    /// The 180 points with integer coordinates on a circle of radius 5525.
+    std::vector<Point> circle_points()
+    {
+        const std::int64_t r {5525};
+        std::vector<Point> points;
+        for (std::int64_t x = -r; x <= r; ++x) {
+            std::int64_t y {std::llround(std::sqrt(double(r * r - x * x)))};
+            if (x * x + y * y != r * r) continue;
+            points.push_back(point(r + x, r + y));
+            if (y != 0) points.push_back(point(r + x, r - y));
+        }
+        return points;
+    }
+
+    /// n points on a line.
+    std::vector<Point> line_points(size_t n)
+    {
+        std::vector<Point> points;
+        for (size_t i = 0; i < n; ++i) {
+            std::int64_t t {static_cast<std::int64_t>(i) * 517};
+            points.push_back(point(t, 3 * t));
+        }
+        return points;
+    }
+
+    template<typename Dt>
+    std::set<Triangle> triangles(const Dt &dt)
+    {
+        std::set<Triangle> t;
+        for (auto it = dt.finite_faces_begin(); it != dt.finite_faces_end(); ++it) {
+            Triangle tr {{key(it->vertex(0)->point()), key(it->vertex(1)->point()),
+                key(it->vertex(2)->point())}};
+            std::sort(tr.begin(), tr.end());
+            t.insert(tr);
+        }
+        return t;
+    }
+
+    std::set<Key> vertices(const std::set<Triangle> &triangles)
+    {
+        std::set<Key> v;
+        for (const auto &t: triangles) v.insert(t.begin(), t.end());
+        return v;
+    }
+
+    /**
+     * \brief Check that the finite faces are counterclockwise, that their
+     * neighbors refer back to them and that no neighbor has its opposite
+     * vertex strictly inside the circumcircle of the face, which makes the
+     * whole triangulation Delaunay.
+     */
+    template<typename Dt>
+    bool is_delaunay(const Dt &dt)
+    {
+        const Epick k;
+        auto orientation = k.orientation_2_object();
+        auto side = k.side_of_oriented_circle_2_object();
+        for (auto it = dt.finite_faces_begin(); it != dt.finite_faces_end(); ++it) {
+            typename Dt::Face_handle f = it;
+            const Point a {f->vertex(0)->point()};
+            const Point b {f->vertex(1)->point()};
+            const Point c {f->vertex(2)->point()};
+            if (orientation(a, b, c) != CGAL::COUNTERCLOCKWISE) return false;
+            for (int i = 0; i < 3; ++i) {
+                typename Dt::Face_handle n = f->neighbor(i);
+                int j {0};
+                while (j < 3 && (n->vertex(j) == f->vertex(Dt::ccw(i)) ||
+                                 n->vertex(j) == f->vertex(Dt::cw(i)))) {
+                    ++j;
+                }
+                if (j == 3 || n->neighbor(j) != f) return false;
+                if (dt.is_infinite(n)) continue;
+                if (side(a, b, c, n->vertex(j)->point()) == CGAL::ON_POSITIVE_SIDE) {
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+
+    /**
+     * \brief Compare the triangulation with the reference. The triangles
+     * must be the same if the points are in general position, and
+     * otherwise they may differ only where the points are cocircular.
+     */
+    template<typename Dt>
+    void compare(
+        const std::string &test,
+        const Dt &dt,
+        const Reference &ref,
+        bool general)
+    {
+        check(dt.dimension() == ref.dimension(), test, "dimension");
+        check(dt.number_of_vertices() == ref.number_of_vertices(), test,
+            "number of vertices");
+        if (ref.dimension() < 2) return;
+        const std::set<Triangle> t {triangles(dt)};
+        const std::set<Triangle> r {triangles(ref)};
+        check(t.size() == r.size(), test, "number of triangles");
+        check(vertices(t) == vertices(r), test, "vertices");
+        check(is_delaunay(dt), test, "Delaunay property");
+        if (general) check(t == r, test, "triangles");
+    }
+
+    /// Check that the elevation of the first of the duplicates was kept.
+    void compare_elevations(
+        const std::string &test,
+        const CompactDelaunay &dt,
+        const std::map<Key, double> &z)
+    {
+        bool ok {true};
+        for (auto it = dt.finite_faces_begin(); it != dt.finite_faces_end(); ++it) {
+            for (int i = 0; i < 3; ++i) {
+                ok = ok && it->vertex(i)->info().z == z.at(key(it->vertex(i)->point()));
+            }
+        }
+        check(ok, test, "elevations");
+    }
+
+    /**
+     * \brief Compare the Sibson coordinates of NaturalNeighborKernel on dt
+     * at the query points with those of CGAL on the reference, normalized
+     * and matched by the points of the neighbors.
+     */
+    template<typename Dt>
+    void compare_coordinates(
+        const std::string &test,
+        const Dt &dt,
+        const Reference &ref,
+        const std::vector<Point> &queries)
+    {
+        const double tolerance {1e-9};
+        NaturalNeighborKernel<Dt> kernel;
+        typename Dt::Face_handle hint;
+        size_t n_different {0};
+        for (const Point &p: queries) {
+            std::vector<std::pair<Point, Epick::FT>> coords;
+            auto result = CGAL::natural_neighbor_coordinates_2(
+                ref, p, std::back_inserter(coords));
+            bool inside {kernel.compute(dt, p, hint)};
+            hint = kernel.face();
+            if (inside != result.third) {
+                ++n_different;
+                continue;
+            }
+            if (!inside) continue;
+
+            std::map<Key, double> expected;
+            for (const auto &c: coords) {
+                expected[key(c.first)] += c.second / result.second;
+            }
+            std::map<Key, double> actual;
+            for (const auto &n: kernel.neighbors()) {
+                actual[key(n.first->point())] += n.second / kernel.norm();
+            }
+            for (const auto &e: expected) actual.emplace(e.first, 0.0);
+            for (const auto &a: actual) {
+                auto e = expected.find(a.first);
+                double w {e == expected.end() ? 0.0 : e->second};
+                if (std::fabs(a.second - w) > tolerance) {
+                    ++n_different;
+                    break;
+                }
+            }
+        }
+        check(n_different == 0, test, "natural neighbor coordinates at " +
+            std::to_string(n_different) + " of " +
+            std::to_string(queries.size()) + " points");
+    }
+
+    /**
+     * \brief Random points around the bounding box of the points, some of
+     * the points themselves and the midpoints of some of the edges.
+     */
+    std::vector<Point> query_points(
+        std::mt19937_64 &rng,
+        const std::vector<Point> &points,
+        const Reference &ref)
+    {
+        std::int64_t x_min {0}, x_max {0}, y_min {0}, y_max {0};
+        for (const auto &p: points) {
+            Key k {key(p)};
+            x_min = std::min(x_min, k.first);
+            x_max = std::max(x_max, k.first);
+            y_min = std::min(y_min, k.second);
+            y_max = std::max(y_max, k.second);
+        }
+        const std::int64_t dx {(x_max - x_min) / 10 + 1}, dy {(y_max - y_min) / 10 + 1};
+        std::uniform_int_distribution<std::int64_t> ux {x_min - dx, x_max + dx};
+        std::uniform_int_distribution<std::int64_t> uy {y_min - dy, y_max + dy};
+        std::uniform_real_distribution<double> frac {0, 1};
+
+        std::vector<Point> queries;
+        for (int i = 0; i < 1000; ++i) {
+            std::int64_t x {ux(rng)};
+            queries.push_back(Point(
+                x_origin + (x + frac(rng)) * unit,
+                y_origin + (uy(rng) + frac(rng)) * unit));
+        }
+        const size_t step {std::max<size_t>(1, points.size() / 200)};
+        for (size_t i = 0; i < points.size(); i += step) queries.push_back(points[i]);
+        size_t n_edges {0};
+        for (auto it = ref.finite_faces_begin();
+             it != ref.finite_faces_end() && n_edges < 200; ++it, ++n_edges) {
+            Point a {it->vertex(0)->point()}, b {it->vertex(1)->point()};
+            queries.push_back(Point((a.x() + b.x()) / 2, (a.y() + b.y()) / 2));
+        }
+        return queries;
+    }
+
+    /**
+     * \brief Triangulate the points with CompactDelaunay, both at once and
+     * one by one, and compare the triangulations and the natural neighbor
+     * coordinates with CGAL.
+     */
+    void test_compact(
+        std::mt19937_64 &rng,
+        const std::string &name,
+        const std::vector<Point> &points,
+        bool general)
+    {
+        std::uniform_real_distribution<double> uz {-10, 1000};
+        std::vector<double> z;
+        std::map<Key, double> first_z;
+        for (const auto &p: points) {
+            z.push_back(uz(rng));
+            first_z.emplace(key(p), z.back());
+        }
+
+        Reference ref;
+        ref.insert(points.begin(), points.end());
+
+        CompactDelaunay at_once {unit};
+        at_once.insert(points, z);
+        compare(name + ", compact at once", at_once, ref, general);
+        compare_elevations(name + ", compact at once", at_once, first_z);
+
+        CompactDelaunay one_by_one {unit};
+        for (size_t i = 0; i < points.size(); ++i) one_by_one.insert(points[i], z[i]);
+        compare(name + ", compact one by one", one_by_one, ref, general);
+        compare_elevations(name + ", compact one by one", one_by_one, first_z);
+
+        if (ref.dimension() < 2) return;
+        const std::vector<Point> queries {query_points(rng, points, ref)};
+        compare_coordinates(name + ", kernel on CGAL", ref, ref, queries);
+        compare_coordinates(name + ", kernel on compact", at_once, ref, queries);
+    }
+
+#ifndef COMPACT_TIN
+    /**
+     * \brief Triangulate the points with build_delaunay_parallel() in 4
+     * threads and compare the triangulation with CGAL. With the points in
+     * general position the parallel construction must succeed.
+     */
+    void test_parallel(
+        const std::string &name,
+        std::vector<Point> points,
+        bool general)
+    {
+        using io::point_cloud::TIN;
+
+        std::sort(points.begin(), points.end(), [](const Point &a, const Point &b) {
+            return a.x() < b.x() || (a.x() == b.x() && a.y() < b.y());
+        });
+        points.erase(std::unique(points.begin(), points.end(), [](const Point &a, const Point &b) {
+            return a.x() == b.x() && a.y() == b.y();
+        }), points.end());
+        std::vector<std::pair<TIN::Point, TIN::VertexInfo>> input;
+        for (const auto &p: points) input.emplace_back(p, TIN::VertexInfo(0));
+
+        Reference ref;
+        ref.insert(points.begin(), points.end());
+
+        TIN::Delaunay_triangulation T;
+        bool built {io::point_cloud::build_delaunay_parallel(T, input, 4)};
+        if (general) check(built, name + ", parallel", "construction");
+        if (!built) {
+            check(T.number_of_vertices() == 0, name + ", parallel", "empty triangulation");
+            return;
+        }
+        compare(name + ", parallel", T, ref, general);
+    }
+#endif
+
+}
+
+int main()
+{
+    std::mt19937_64 rng {12345};
+
+    test_compact(rng, "random", random_points(rng, 20000), true);
+    test_compact(rng, "grid", grid_points(150, 150), false);
+    test_compact(rng, "cocircular", circle_points(), false);
+
+    std::vector<Point> collinear {line_points(1000)};
+    test_compact(rng, "line", collinear, false);
+    for (const auto &p: random_points(rng, 5000)) collinear.push_back(p);
+    test_compact(rng, "collinear first", collinear, false);
+
+    const std::vector<Point> unique {random_points(rng, 5000)};
+    std::vector<Point> duplicates {unique};
+    duplicates.insert(duplicates.end(), unique.begin(), unique.end());
+    std::shuffle(duplicates.begin() + unique.size(), duplicates.end(), rng);
+    test_compact(rng, "duplicates", duplicates, true);
+
+#ifndef COMPACT_TIN
+    // The parallel construction needs at least 2^16 points per strip.
+    test_parallel("random", random_points(rng, 300000), true);
+    test_parallel("grid", grid_points(550, 550), false);
+#endif
+
+    if (n_failures > 0) {
+        std::cout << n_failures << " comparisons with CGAL failed" << std::endl;
+        return 1;
+    }
+    std::cout << "The triangulations and the natural neighbor coordinates agree with CGAL"
+        << std::endl;
+    return 0;
+}